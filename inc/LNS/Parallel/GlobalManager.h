@@ -30,7 +30,8 @@ public:
     string init_algo_name;
     string replan_algo_name;
     Instance & instance;
-    PathTable path_table;
+    MVCCPathTable shared_path_table; // read by the local optimizers, written by update()
+    PathTable path_table; // a view of the newest versions of the shared path table
     std::vector<Agent> agents;
     std::shared_ptr<HeuristicTable> HT;
     std::shared_ptr<vector<float> > map_weights;
@@ -39,13 +40,16 @@ public:
 
     std::shared_ptr<std::vector<LaCAM2::AgentInfo> > agent_infos;
 
-    std::vector<std::vector<Neighbor>> updating_queues; // the generated neighbors for usage
-    std::vector<omp_lock_t> updating_queue_locks;
-
     bool has_disabled_agents=false;
 
     bool async=false;
 
+    // run in rounds: the neighbors of a round are optimized in parallel on the same snapshot,
+    // then committed in the order of their thread ids. with the seeded per-thread streams, a run is
+    // reproducible as long as it stops at max_iterations rather than at the time limit.
+    bool deterministic=false;
+    int max_iterations;
+
     GlobalManager(
         bool async,
         Instance & instance, std::shared_ptr<HeuristicTable> HT, 
@@ -56,6 +60,7 @@ public:
         int window_size_for_CT, int window_size_for_CAT, int window_size_for_PATH, int execution_window,
         bool has_disabled_agents,
         bool fix_ng_bug,
+        bool deterministic, int max_iterations, int seed,
         int screen
     );
 
@@ -67,8 +72,13 @@ public:
     bool run(TimeLimiter & time_limiter);
     void update(Neighbor & neighbor, bool recheck);
     void update(Neighbor & neighbor);
+    // commit the neighbor optimized by a thread and record the iteration.
+    void commit(NeighborGenerator & generator, Neighbor & neighbor, TimeLimiter & time_limiter);
     void reset();
 
+    // LNS_NUM_THREADS or all threads
+    static int get_num_threads();
+
     string getSolverName() const { return "LNS(" + init_algo_name + ";" + replan_algo_name + ")"; }
 
 };
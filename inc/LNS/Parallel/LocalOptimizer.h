@@ -3,7 +3,9 @@
 #include "util/HeuristicTable.h"
 #include "util/TimeLimiter.h"
 #include "LNS/Parallel/TimeSpaceAStarPlanner.h"
+#include "LNS/Parallel/SIPPPlanner.h"
 #include "LaCAM2/instance.hpp"
+#include "util/Philox.h"
 
 namespace LNS {
 
@@ -14,18 +16,21 @@ class LocalOptimizer
 public:
     // : think about what data structure needs a separate copy for each local optimizer.
     Instance & instance;
-    PathTable path_table; // maintain a copy
+    MVCCPathTable * shared_path_table;
+    int reader; // id of this optimizer as a reader of the shared path table
+    const MVCCPathTable::Commit * synced_commit; // the last commit applied to agents
+    PathTable path_table; // a view of the shared path table, with the paths of the neighbor being planned
     std::vector<Agent> agents; // remove in the future, currently we can visit it for agent id but not do anything else.
     std::shared_ptr<HeuristicTable> HT;
     std::shared_ptr<vector<float> > map_weights;
+    bool sipp; // plan with sipp_planner instead of path_planner
     std::shared_ptr<TimeSpaceAStarPlanner> path_planner;
+    std::shared_ptr<SIPPPlanner> sipp_planner;
 
-    std::mt19937 MT; 
+    Philox MT; // stream 2*reader+1 of the seed
 
     std::shared_ptr<std::vector<LaCAM2::AgentInfo> > agent_infos;
 
-    std::vector<Neighbor> updating_queue;
-
     string replan_algo_name;
     int window_size_for_CT;
     int window_size_for_CAT;
@@ -42,11 +47,15 @@ public:
         int window_size_for_CT, int window_size_for_CAT, int window_size_for_PATH, int execution_window,
         bool has_disable_agents,
         int screen,
-        int random_seed
+        int random_seed,
+        MVCCPathTable * shared_path_table,
+        int reader
     );
 
-    // the global manager will push global changes to local optimizer though this function. 
-    void update(Neighbor & neighbor);
+    // take the newest snapshot of the shared path table and copy the paths changed since the last one.
+    void sync();
+    // stop reading the snapshot, so that its versions can be reclaimed.
+    void release();
     void optimize(Neighbor & neighbor, const TimeLimiter & time_limiter);
     void prepare(Neighbor & neighbor);
 
@@ -0,0 +1,102 @@
+#pragma once
+#include "LNS/Parallel/DataStructure.h"
+#include <atomic>
+#include <cstdint>
+#include <deque>
+
+#define NO_AGENT -1
+
+namespace LNS {
+
+namespace Parallel {
+
+// the path table shared by all the threads of the lns, in place of a replica per thread.
+// a commit adds new versions of the changed cells and paths, stamped with the next epoch, and then publishes the epoch.
+// a reader announces the published epoch as its snapshot and sees the newest versions that are not newer.
+// there is a single writer at a time. versions that no announced snapshot can see any more are reused by later commits.
+class MVCCPathTable
+{
+public:
+    static const uint64_t LATEST = UINT64_MAX; // the newest versions, for the writer only
+
+    struct CellVersion {
+        int agent;
+        int prev; // location of the agent at t-1, -1 at t=0
+        uint64_t epoch;
+        CellVersion * older;
+    };
+
+    struct PathVersion {
+        Path path;
+        uint64_t epoch;
+        PathVersion * older;
+    };
+
+    // the agents whose paths are changed by a commit
+    struct Commit {
+        uint64_t epoch;
+        vector<int> agents;
+        std::atomic<Commit *> next{nullptr};
+    };
+
+    int map_size;
+    int window_size;
+
+    MVCCPathTable(int map_size, int window_size, int num_of_agents, int num_of_readers);
+    ~MVCCPathTable();
+    MVCCPathTable(const MVCCPathTable &) = delete;
+    MVCCPathTable & operator=(const MVCCPathTable &) = delete;
+
+    inline int horizon() const { return window_size+1; }
+
+    // reader: announce the current epoch as the snapshot of the reader. it is kept until the next acquire or release.
+    uint64_t acquire(int reader);
+    void release(int reader);
+
+    inline const CellVersion * getCell(int loc, int t, uint64_t snapshot) const {
+        auto v=cells[t*map_size+loc].load(std::memory_order_acquire);
+        while (v!=nullptr && v->epoch>snapshot)
+            v=v->older;
+        return v;
+    }
+    inline int getAgent(int loc, int t, uint64_t snapshot) const {
+        auto v=getCell(loc,t,snapshot);
+        return v!=nullptr ? v->agent : NO_AGENT;
+    }
+    const Path & getPath(int agent, uint64_t snapshot) const;
+    // the commits are a list after this sentinel, in the order of their epochs.
+    inline const Commit * firstCommit() const { return &commits; }
+
+    // writer: replace the old paths of the neighbor by its new ones.
+    void commit(Neighbor & neighbor);
+    // drop all versions, no reader may be active.
+    void reset();
+
+private:
+    std::atomic<uint64_t> epoch{0};
+    vector<std::atomic<CellVersion *> > cells; // indexed by t*map_size+loc
+    vector<std::atomic<PathVersion *> > paths;
+
+    struct alignas(64) Announcement {
+        std::atomic<uint64_t> snapshot{LATEST};
+    };
+    vector<Announcement> readers;
+
+    Commit commits;
+    Commit * last_commit;
+
+    // versions written, to be trimmed once every snapshot has moved past their epoch
+    std::deque<std::pair<uint64_t, int> > written_cells;
+    std::deque<std::pair<uint64_t, int> > written_paths;
+    vector<int> touched_cells;
+    vector<int> touched_paths;
+    vector<CellVersion *> free_cells;
+    vector<PathVersion *> free_paths;
+
+    void pushCell(int loc, int t, int agent, int prev, uint64_t e);
+    void collect();
+};
+
+}
+
+}
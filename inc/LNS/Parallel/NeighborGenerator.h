@@ -5,6 +5,7 @@
 #include "util/HeuristicTable.h"
 #include "LNS/PathTable.h"
 #include "LaCAM2/instance.hpp"
+#include "util/Philox.h"
 
 namespace LNS {
 
@@ -18,7 +19,7 @@ public:
     PathTable & path_table;
     std::vector<Agent> & agents;
 
-    std::mt19937 MT; 
+    std::vector<Philox> MTs; // one stream per thread index, since generate_parallel runs the indices concurrently
 
     std::shared_ptr<std::vector<LaCAM2::AgentInfo> > agent_infos;
 
@@ -64,21 +65,20 @@ public:
     Neighbor generate(const TimeLimiter & time_limiter,int idx);
     void update(Neighbor & neighbor);
 
-    void chooseDestroyHeuristicbyALNS();
+    destroy_heuristic chooseDestroyHeuristicbyALNS(int idx);
     bool generateNeighborByRandomWalk(Neighbor & neighbor, int idx);
-    bool generateNeighborByIntersection(Neighbor & neighbor);
+    bool generateNeighborByIntersection(Neighbor & neighbor, int idx);
 
     void reset();
 
 private:
-    int rouletteWheel();
+    int rouletteWheel(int idx);
 
     int findMostDelayedAgent(int idx);
     void randomWalk(
         int agent_id, int start_timestep, 
-        set<int>& conflicting_agents, int neighbor_size
+        set<int>& conflicting_agents, int neighbor_size, int idx
     );
-    std::list<std::pair<int,int> > getSuccessors(int loc, int orient);
 
 };
 
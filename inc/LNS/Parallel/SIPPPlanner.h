@@ -0,0 +1,79 @@
+#pragma once
+#include "LNS/Parallel/TimeSpaceAStarState.h"
+#include "LNS/Parallel/StateHeap.h"
+#include "LNS/Instance.h"
+#include <utility>
+#include <cstdint>
+#include "LNS/ConstraintTable.h"
+#include "util/HeuristicTable.h"
+#include "LNS/Parallel/DataStructure.h"
+#include "util/TimeLimiter.h"
+
+namespace LNS {
+
+namespace Parallel {
+
+// a state of sipp: the agent arrives at (pos, orient) at t and may wait there until its safe interval ends.
+struct SIPPState: public TimeSpaceAStarState {
+    int interval; // id of the safe interval of pos that contains t
+    bool terminal; // the agent waits from t to the end of the window
+};
+
+// safe interval path planning within window_size_for_PATH, in place of TimeSpaceAStarPlanner.
+// the safe intervals of a cell are its free timesteps before window_size_for_CT in the path table, merged into maximal runs.
+// a state is (interval, orient, arrived) with its earliest arrival, so the waits do not expand any node.
+// the order of the open list and the conflict counts are the same as in TimeSpaceAStarPlanner, but when a later
+// arrival in the same interval would have fewer soft conflicts, the earlier one is kept.
+class SIPPPlanner {
+public:
+    Instance & instance;
+    std::shared_ptr<HeuristicTable> HT;
+    std::shared_ptr<vector<float> > weights;
+    int execution_window;
+
+    std::vector<SIPPState> states; // the states generated by the current search
+    StateHeap<SIPPState, TimeSpaceAStarState::Compare> open_list;
+
+    // safe intervals [first, second) of the cells touched by the current search, computed on demand.
+    // the intervals of a cell are valid if its stamp is the one of the current search.
+    std::vector<std::pair<int,int> > intervals;
+    std::vector<int> cell_intervals; // cell -> index of its first interval
+    std::vector<int> cell_num_intervals;
+    std::vector<uint32_t> cell_stamps;
+
+    std::vector<int> state_ids; // (interval, orient, arrived, terminal) -> index in states
+    std::vector<uint32_t> stamps;
+    uint32_t stamp=0;
+
+    int n_expanded;
+    int n_generated;
+
+    // results
+    Path path;
+
+    static const int n_dirs=5; // east, south, west, north, stay
+    static const int n_orients=4; // east, south, west, north
+
+    SIPPPlanner(Instance & instance, std::shared_ptr<HeuristicTable> HT, std::shared_ptr<vector<float> > weights, int execution_window);
+    void findPath(int start_pos, int start_orient, int goal_pos, ConstraintTable & constraint_table, const TimeLimiter & time_limiter);
+    void clear();
+    void buildPath(int curr, int goal_pos);
+
+private:
+    // the first interval of the cell, and the number of them.
+    std::pair<int,int> getIntervals(int pos, const ConstraintTable & constraint_table);
+    // the soft conflicts of waiting at pos from t_from to t_to
+    int getNumOfConflictsForWait(int pos, int t_from, int t_to, const ConstraintTable & constraint_table) const;
+    inline float getWaitCost(int pos) const {
+        return (*weights)[pos*n_dirs+4];
+    }
+    inline int stateKey(int interval, int orient, bool arrived, bool terminal) const {
+        return ((interval*n_orients+orient)*2+arrived)*2+terminal;
+    }
+    // add a state unless it exists, or improve the existing one if it has fewer conflicts or a smaller f.
+    void generate(int pos, int orient, int t, float g, float h, int num_of_conflicts, bool arrived, int prev, int interval, bool terminal);
+};
+
+}
+
+} // namespace LNS
@@ -0,0 +1,90 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+
+namespace LNS {
+
+namespace Parallel {
+
+// a d-ary heap of the ids of pooled states. a state keeps its position in the heap as heap_index, -1 when it is not in it.
+// Compare(a,b) is true if a is expanded after b, as for the priority queues of the standard library.
+template <typename State, typename Compare, int arity=4>
+class StateHeap {
+public:
+    explicit StateHeap(std::vector<State> & states): states(states) {}
+
+    inline bool empty() const { return heap.empty(); }
+    inline size_t size() const { return heap.size(); }
+    inline void clear() { heap.clear(); }
+
+    void push(int id) {
+        heap.push_back(id);
+        siftUp((int)heap.size()-1);
+    }
+
+    int pop() {
+        int top=heap.front();
+        int last=heap.back();
+        heap.pop_back();
+        if (!heap.empty()) {
+            heap[0]=last;
+            siftDown(0);
+        }
+        states[top].heap_index=-1;
+        return top;
+    }
+
+    // restore the order after the state got better
+    inline void increase(int id) {
+        siftUp(states[id].heap_index);
+    }
+
+private:
+    std::vector<State> & states;
+    std::vector<int> heap;
+
+    inline bool before(int a, int b) const {
+        return Compare()(states[b], states[a]);
+    }
+
+    void siftUp(int i) {
+        int id=heap[i];
+        while (i>0) {
+            int parent=(i-1)/arity;
+            if (!before(id,heap[parent]))
+                break;
+            heap[i]=heap[parent];
+            states[heap[i]].heap_index=i;
+            i=parent;
+        }
+        heap[i]=id;
+        states[id].heap_index=i;
+    }
+
+    void siftDown(int i) {
+        int id=heap[i];
+        int n=(int)heap.size();
+        while (true) {
+            int first=i*arity+1;
+            if (first>=n)
+                break;
+            int best=first;
+            int last=std::min(first+arity,n);
+            for (int c=first+1;c<last;++c) {
+                if (before(heap[c],heap[best]))
+                    best=c;
+            }
+            if (!before(heap[best],id))
+                break;
+            heap[i]=heap[best];
+            states[heap[i]].heap_index=i;
+            i=best;
+        }
+        heap[i]=id;
+        states[id].heap_index=i;
+    }
+};
+
+}
+
+}
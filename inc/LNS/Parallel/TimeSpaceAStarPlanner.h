@@ -1,8 +1,9 @@
 #pragma once
 #include "LNS/Parallel/TimeSpaceAStarState.h"
-#include "boost/unordered_set.hpp"
+#include "LNS/Parallel/StateHeap.h"
 #include "LNS/Instance.h"
 #include <utility>
+#include <cstdint>
 #include "LNS/ConstraintTable.h"
 #include "util/HeuristicTable.h"
 #include "LNS/Parallel/DataStructure.h"
@@ -12,6 +13,10 @@ namespace LNS {
 
 namespace Parallel {
 
+// a* over (location, orientation, timestep) within window_size_for_PATH.
+// the agent can only reach the cells within window_size_for_PATH moves of its start, so a state (t, pos, orient, arrived)
+// has a dense id in that box of cells. the ids are valid if their stamp is the one of the current search,
+// so nothing is cleared between searches. the states are pooled and the open list is a heap of their ids.
 class TimeSpaceAStarPlanner {
 public:
     Instance & instance;
@@ -19,10 +24,12 @@ public:
     std::shared_ptr<vector<float> > weights;
     int execution_window;
 
-    boost::heap::pairing_heap<TimeSpaceAStarState*, boost::heap::compare<TimeSpaceAStarState::Compare> > open_list;
-    boost::unordered_set<TimeSpaceAStarState*, TimeSpaceAStarState::Hash, TimeSpaceAStarState::Equal> all_states;
+    std::vector<TimeSpaceAStarState> states; // the states generated by the current search
+    StateHeap<TimeSpaceAStarState, TimeSpaceAStarState::Compare> open_list;
 
-    std::vector<TimeSpaceAStarState*> successors;
+    std::vector<int> state_ids; // dense id -> index in states
+    std::vector<uint32_t> stamps; // dense id -> the search that set state_ids
+    uint32_t stamp=0;
 
     int n_expanded;
     int n_generated;
@@ -36,10 +43,22 @@ public:
     TimeSpaceAStarPlanner(Instance & instance, std::shared_ptr<HeuristicTable> HT, std::shared_ptr<vector<float> > weights, int execution_window);
     void findPath(int start_pos, int start_orient, int goal_pos, ConstraintTable & constraint_table, const TimeLimiter & time_limiter);
     void clear();
-    void buildPath(TimeSpaceAStarState * curr, int goal_pos);
-    void getSuccessors(TimeSpaceAStarState * state, int goal_pos, ConstraintTable & constraint_table);
+    void buildPath(int curr, int goal_pos);
+
+private:
+    // the box of cells reachable in the window
+    int box_x0, box_y0, box_w, box_h;
+
+    void setupBox(int start_pos, int window);
+    inline int denseId(int pos, int orient, int t, bool arrived) const {
+        int x=pos%instance.num_of_cols-box_x0;
+        int y=pos/instance.num_of_cols-box_y0;
+        return (((t*box_h+y)*box_w+x)*n_orients+orient)*2+arrived;
+    }
+    // add a state unless it exists, or improve the existing one if it has fewer conflicts or a smaller f.
+    void generate(int pos, int orient, int t, float g, float h, int num_of_conflicts, bool arrived, int prev);
 };
 
 }
 
-} // namespace LNS
\ No newline at end of file
+} // namespace LNS
@@ -1,19 +1,38 @@
 #pragma once
 #include "LNS/common.h"
 #include "LNS/Parallel/DataStructure.h"
-
-#define NO_AGENT -1
+#include "LNS/Parallel/MVCCPathTable.h"
+#include "util/Philox.h"
 
 namespace LNS {
 
+// collision-free paths within a planning window of window_size steps.
+// the cells are one flat buffer of (window_size+1)*map_size entries, time-major, so that the cells checked for a move
+// are close to each other. every cell also keeps where its agent came from, which makes the edge check a single lookup.
+// reset() only clears the cells written since the last reset.
+// with a base, the table is a view of a snapshot of the shared table: its own cells come first, then the cells of the
+// base that do not belong to hidden agents. the base may have a longer window, the view only reads its first horizon() steps.
 class PathTable
 {
 public:
+    struct Cell {
+        int agent = NO_AGENT;
+        int prev = UNTOUCHED; // location of the agent at t-1, -1 at t=0
+    };
+    static const int UNTOUCHED = -2;
+
     int makespan = 0;
     int window_size = -1;
-    vector< vector<int> > table; // this stores the collision-free paths, the value is the id of the agent
+    int map_size = 0;
+    vector<Cell> table; // this stores the collision-free paths, indexed by t*map_size+loc
     vector<int> goals; // this stores the goal locatons of the paths: key is the location, while value is the timestep when the agent reaches the goal
-    void reset() { auto map_size = table.size(); table.clear(); table.resize(map_size); goals.assign(map_size, MAX_TIMESTEP); makespan = 0; }
+    const Parallel::MVCCPathTable * base = nullptr;
+    uint64_t snapshot = Parallel::MVCCPathTable::LATEST;
+    vector<char> hidden; // agents of the base whose paths are ignored
+    void setBase(const Parallel::MVCCPathTable * base, int num_of_agents);
+    inline void hide(int agent_id) { hidden[agent_id] = true; }
+    inline void unhide(int agent_id) { hidden[agent_id] = false; }
+    void reset();
     void insertPath(int agent_id, const Path& path, bool verbose=false);
     void deletePath(int agent_id, const Path& path, bool verbose=false);
     void insertPath(int agent_id, const Parallel::Path& path,bool verbose=false);
@@ -21,11 +40,45 @@ public:
     bool constrained(int from, int to, int to_time) const;
     bool constrained(int from, int to, int to_time, std::vector<int> & ignored_agents) const;
 
+    inline bool empty() const { return table.empty(); }
+    // number of timesteps stored
+    inline int horizon() const { return window_size+1; }
+    // the agent at loc at time t
+    inline int getAgent(int loc, int t) const {
+        if (t<0 || t>=horizon())
+            return NO_AGENT;
+        int agent=table[t*map_size+loc].agent;
+        if (agent==NO_AGENT && base!=nullptr) {
+            agent=base->getAgent(loc,t,snapshot);
+            if (agent!=NO_AGENT && hidden[agent])
+                agent=NO_AGENT;
+        }
+        return agent;
+    }
+    // the agent that moves from to to from, arriving at time t
+    inline int getEdgeAgent(int from, int to, int t) const {
+        if (t<1 || t>=horizon() || from==to)
+            return NO_AGENT;
+        auto & cell=table[t*map_size+from];
+        if (cell.agent!=NO_AGENT)
+            return cell.prev==to ? cell.agent : NO_AGENT;
+        if (base!=nullptr) {
+            auto v=base->getCell(from,t,snapshot);
+            if (v!=nullptr && v->agent!=NO_AGENT && v->prev==to && !hidden[v->agent])
+                return v->agent;
+        }
+        return NO_AGENT;
+    }
+
     void get_agents(set<int>& conflicting_agents, int loc) const;
-    void get_agents(set<int>& conflicting_agents, int neighbor_size, int loc) const;
+    void get_agents(set<int>& conflicting_agents, int neighbor_size, int loc, Philox & MT) const;
     void getConflictingAgents(int agent_id, set<int>& conflicting_agents, int from, int to, int to_time) const;;
     int getHoldingTime(int location, int earliest_timestep) const;
-    explicit PathTable(int map_size = 0, int window_size=-1) : table(map_size), goals(map_size, MAX_TIMESTEP), window_size(window_size) {}
+    explicit PathTable(int map_size = 0, int window_size=-1);
+private:
+    vector<int> touched_cells; // cells written since the last reset
+    vector<int> touched_goals;
+    void setCell(int loc, int t, int agent_id, int prev);
 };
 
 class PathTableWC // with collisions
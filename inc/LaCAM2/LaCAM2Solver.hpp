@@ -24,7 +24,8 @@ public:
     int total_feasible_timestep = 0;
     int timestep = 0;
     void initialize(const SharedEnvironment & env);
-    void plan(const SharedEnvironment & env, std::vector<Path> * precomputed_paths=nullptr, std::vector<::State> * starts=nullptr, std::vector<::State> * goals=nullptr);
+    // time_limit_ms: the time the caller can spend on this call.
+    void plan(const SharedEnvironment & env, std::vector<Path> * precomputed_paths=nullptr, std::vector<::State> * starts=nullptr, std::vector<::State> * goals=nullptr, double time_limit_ms=2000);
     void get_step_actions(const SharedEnvironment & env, vector<Action> & actions);
     // Action get_action_from_states(const State & state, const State & next_state);
     // [end]
@@ -46,6 +47,13 @@ public:
 
     bool use_external_executor=false; 
 
+    // warm start: the rest of the previous plan seeds the next search for agents that follow it and keep their goals.
+    // with SUO, the other agents are seeded by their SUO paths.
+    bool warm_start=false;
+    std::vector<Path> prev_paths;
+    // index of the current state in prev_paths
+    int prev_timestep=0;
+
     int num_task_completed=0;
     int max_task_completed;
 
@@ -56,6 +64,10 @@ public:
 
     Executor executor;
     SlowExecutor slow_executor;
+    // nodes of the planner, kept between plan calls so that replanning reuses the memory.
+    Arena arena;
+    // arenas of the other members of the portfolio.
+    std::vector<std::unique_ptr<Arena> > portfolio_arenas;
 
     nlohmann::json config;
 
@@ -86,6 +98,7 @@ public:
         execution_window=read_param_json<int>(config,"execution_window");
 
         disable_agent_goals=read_param_json<bool>(config,"disable_agent_goals");
+        warm_start=read_param_json<bool>(config,"warm_start",false);
             
     };
 
@@ -99,6 +112,7 @@ public:
 
         paths.clear();
         paths.resize(env.num_of_agents);
+        prev_paths.clear();
         
         need_replan = true;
         total_feasible_timestep = 0;
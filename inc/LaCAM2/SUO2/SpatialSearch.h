@@ -72,116 +72,17 @@ public:
 
     void get_successors(State * curr, int goal_pos) {
         successors.clear();
-        int pos=curr->pos;
-        int x=pos%(env.cols);
-        int y=pos/(env.cols);
-        int orient=curr->orient;
-
-        // FW
-        int next_pos;
-        int next_orient;
-        int weight_idx;
-        next_orient=orient;
-        if (orient==0) {
-            // east
-            if (x+1<env.cols){
-                next_pos=pos+1;
-                weight_idx=pos*n_dirs;
-                if (env.map[next_pos]==0) {
-                    successors.push_back(new State(
-                        next_pos, 
-                        next_orient, 
-                        curr->g+weights[weight_idx]+cost_map[next_pos], 
-                        HT->get(next_pos, next_orient, goal_pos),
-                        curr
-                    ));
-                }
-            }
-        } else if (orient==1) {
-            // south
-            if (y+1<env.rows) {
-                next_pos=pos+env.cols;
-                weight_idx=pos*n_dirs+1;
-                if (env.map[next_pos]==0) {
-                    successors.push_back(new State(
-                        next_pos, 
-                        next_orient, 
-                        curr->g+weights[weight_idx]+cost_map[next_pos], 
-                        HT->get(next_pos, next_orient, goal_pos),
-                        curr
-                    ));
-                }
-            }
-        } else if (orient==2) {
-            // west
-            if (x-1>=0) { 
-                next_pos=pos-1;
-                weight_idx=pos*n_dirs+2;
-                if (env.map[next_pos]==0) {
-                    successors.push_back(new State(
-                        next_pos, 
-                        next_orient, 
-                        curr->g+weights[weight_idx]+cost_map[next_pos], 
-                        HT->get(next_pos, next_orient, goal_pos),
-                        curr
-                    ));
-                }
-            }
-        } else if (orient==3) {
-            // north
-            if (y-1>=0) {
-                next_pos=pos-env.cols;
-                weight_idx=pos*n_dirs+3;
-                if (env.map[next_pos]==0) {
-                    successors.push_back(new State(
-                        next_pos, 
-                        next_orient, 
-                        curr->g+weights[weight_idx]+cost_map[next_pos], 
-                        HT->get(next_pos, next_orient, goal_pos),
-                        curr
-                    ));
-                }
-            }
-        } else {
-            std::cerr<<"spatial search in heuristics: invalid orient: "<<orient<<endl;
-            exit(-1);
-        }        
-
-
-        next_pos=pos;
-        weight_idx=pos*n_dirs+4;
-        // CR
-        next_orient=(orient+1+n_orients)%n_orients;
-        successors.push_back(new State(
-            next_pos, 
-            next_orient, 
-            curr->g+weights[weight_idx]+cost_map[next_pos], 
-            HT->get(next_pos, next_orient, goal_pos),
-            curr
-        ));
-
-        // CCR
-        next_orient=(orient-1+n_orients)%n_orients;
-        successors.push_back(new State(
-            next_pos, 
-            next_orient, 
-            curr->g+weights[weight_idx]+cost_map[next_pos], 
-            HT->get(next_pos, next_orient, goal_pos),
-            curr
-        ));
-
-        // no wait action because we don't use time in the state
-        // // W
-        // next_orient=orient;
-        // successors.push_back(new State(
-        //     next_pos, 
-        //     next_orient, 
-        //     curr->g+weights[weight_idx], 
-        //     HT->get(next_pos, next_orient, goal_pos),
-        //     curr
-        // ));
-        
-
+        for (auto & e: HT->state_graph->successors(curr->pos, curr->orient)) {
+            // no wait action because we don't use time in the state
+            if (e.action==W) continue;
+            successors.push_back(new State(
+                e.to_pos,
+                e.to_orient,
+                curr->g+e.weight+cost_map[e.to_pos],
+                HT->get(e.to_pos, e.to_orient, goal_pos),
+                curr
+            ));
+        }
     }
 
     State * search(int start_pos, int start_orient, int goal_pos) {
@@ -0,0 +1,69 @@
+/*
+ * arena allocator for search nodes
+ */
+#pragma once
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace LaCAM2 {
+
+// bump allocator for the nodes of one search.
+// reset() destroys all objects and rewinds, the chunks are kept so that later searches do not allocate again.
+class Arena {
+public:
+  explicit Arena(size_t chunk_size = 1 << 20) : chunk_size(chunk_size) {}
+  ~Arena();
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  void* allocate(size_t size, size_t align = alignof(std::max_align_t));
+
+  // objects with a non-trivial destructor are destroyed in reset().
+  template <typename T, typename... Args>
+  T* create(Args&&... args)
+  {
+    T* obj = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    if (!std::is_trivially_destructible<T>::value) {
+      finalizers.emplace_back(obj, [](void* p) { static_cast<T*>(p)->~T(); });
+    }
+    return obj;
+  }
+
+  void reset();
+  size_t capacity() const;
+
+private:
+  struct Chunk {
+    char* data;
+    size_t size;
+  };
+  size_t chunk_size;
+  std::vector<Chunk> chunks;
+  size_t curr = 0;    // chunk we allocate from
+  size_t offset = 0;  // in the current chunk
+  std::vector<std::pair<void*, void (*)(void*)> > finalizers;
+};
+
+// stl allocator on top of an arena, memory is only returned by Arena::reset().
+template <typename T>
+struct ArenaAllocator {
+  typedef T value_type;
+  Arena* arena;
+
+  ArenaAllocator(Arena* _arena) : arena(_arena) {}
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+  T* allocate(size_t n) { return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T))); }
+  void deallocate(T* p, size_t n) {}
+
+  template <typename U>
+  bool operator==(const ArenaAllocator<U>& other) const { return arena == other.arena; }
+  template <typename U>
+  bool operator!=(const ArenaAllocator<U>& other) const { return arena != other.arena; }
+};
+
+}  // namespace LaCAM2
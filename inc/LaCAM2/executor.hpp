@@ -10,15 +10,20 @@ public:
 
     int rows;
     int cols;
-    // loc->agent
-    unordered_map<int,int> reservation_table;
-    vector<bool> executed;
+    // loc->agent, valid if the stamp of loc is the current generation, so clearing it is O(1).
+    vector<int> reservation_table;
+    vector<uint32_t> reservation_stamps;
+    uint32_t generation=0;
+    // 0: not visited, 1: waiting for the agent in front of it, 2: executed
+    vector<uint8_t> status;
+    // agents waiting for the agents in front of them, used instead of recursion so that long chains are fine.
+    vector<int> dependency_stack;
     const vector<State> * curr_states;
     const vector<State> * planned_next_states;
     vector<State> * next_states;
 
-    Executor(const SharedEnvironment * _env):rows(_env->rows), cols(_env->cols){};
-    Executor(int _rows, int _cols): rows(_rows), cols(_cols) {};   
+    Executor(const SharedEnvironment * _env):Executor(_env->rows,_env->cols){};
+    Executor(int _rows, int _cols): rows(_rows), cols(_cols), reservation_table(_rows*_cols,-1), reservation_stamps(_rows*_cols,0) {};
 
     /*
      * NOTE: currently we only consider one step
@@ -32,25 +37,90 @@ public:
         planned_next_states=_planned_next_states;
         next_states=_next_states;
 
-        executed.clear();
-        executed.resize(curr_states->size(),false);
-        reservation_table.clear();
+        if (++generation==0) {
+            std::fill(reservation_stamps.begin(),reservation_stamps.end(),0);
+            generation=1;
+        }
+        status.assign(curr_states->size(),0);
         for (int i=0;i<curr_states->size();++i) {
-            reservation_table[(*curr_states)[i].location]=i;
+            int loc=(*curr_states)[i].location;
+            reservation_table[loc]=i;
+            reservation_stamps[loc]=generation;
         }
 
         for (int i=0;i<curr_states->size();++i) {
-            if (!executed[i]) {
-                execute_agent(i,i);
+            if (status[i]==0) {
+                execute_agent(i);
+            }
+        }
+    }
+
+    /*
+     * batch mode: execute the configurations of a plan one after another. every configuration is
+     * executed until all agents reach it, for at most max_steps steps in total.
+     * the states of every step are appended to paths, which must hold the start states.
+     */
+    template <typename Configs>
+    void execute_plan(const Configs & plan, int max_steps, vector<Path> & paths) {
+        int N=(int)paths.size();
+        vector<State> curr(N), planned(N), next(N);
+        for (int aid=0;aid<N;++aid) {
+            curr[aid]=paths[aid].back();
+        }
+
+        int num_steps=0;
+        for (int i=1;i<plan.size() && num_steps<max_steps;++i) {
+            for (int aid=0;aid<N;++aid) {
+                planned[aid]=State(plan[i].locs[aid],-1,-1);
+            }
+            bool arrived=false;
+            while (!arrived && num_steps<max_steps) {
+                execute(&curr,&planned,&next);
+                ++num_steps;
+
+                arrived=true;
+                for (int aid=0;aid<N;++aid) {
+                    paths[aid].push_back(next[aid]);
+                    arrived&=(next[aid].location==planned[aid].location);
+                }
+                std::swap(curr,next);
             }
         }
     }
 
-    void execute_agent(int agent_idx, int root_agent_idx) {
-        // std::cerr<<"execute agent "<<agent_idx<<endl;
-        assert(!executed[agent_idx]);
-        // put this line here, we can also deal with the loop case
+    // the agent at the location agent_idx forwards into, -1 if it does not forward or the location is free.
+    int get_parent_agent(int agent_idx) {
+        const auto & curr_state=(*curr_states)[agent_idx];
+        const auto & planned_next_state=(*planned_next_states)[agent_idx];
+        if (curr_state.location==planned_next_state.location) return -1;
+        if (curr_state.orientation!=get_neighbor_orientation(curr_state.location,planned_next_state.location)) return -1;
+        int loc=planned_next_state.location;
+        return reservation_stamps[loc]==generation?reservation_table[loc]:-1;
+    }
+
+    void execute_agent(int root_agent_idx) {
+        dependency_stack.clear();
+        dependency_stack.push_back(root_agent_idx);
+        status[root_agent_idx]=1;
+        while (!dependency_stack.empty()) {
+            int agent_idx=dependency_stack.back();
+            int parent_agent_idx=get_parent_agent(agent_idx);
+            if (parent_agent_idx!=-1 && status[parent_agent_idx]==0) {
+                // the agent in front must be executed first
+                status[parent_agent_idx]=1;
+                dependency_stack.push_back(parent_agent_idx);
+                continue;
+            }
+            dependency_stack.pop_back();
+            // a parent still waiting means we have a loop, then all agents in it forward.
+            bool parent_moves=parent_agent_idx==-1 || status[parent_agent_idx]==1 ||
+                (*next_states)[parent_agent_idx].location!=(*curr_states)[parent_agent_idx].location;
+            execute_agent(agent_idx,parent_moves);
+            status[agent_idx]=2;
+        }
+    }
 
+    void execute_agent(int agent_idx, bool parent_moves) {
         const auto & curr_state=(*curr_states)[agent_idx];
         const auto & planned_next_state=(*planned_next_states)[agent_idx];
         auto & next_state=(*next_states)[agent_idx];
@@ -69,34 +139,20 @@ public:
             int curr_orient=curr_state.orientation;
             int expected_orient=get_neighbor_orientation(curr_state.location,planned_next_state.location);
             if (curr_orient==expected_orient) {
-                // it is ready to forward but we need to make sure the next location is empty
-                auto iter=reservation_table.find(planned_next_state.location);
-                if (iter!=reservation_table.end()) {
-                    int parent_agent_idx=iter->second;
-                    if (parent_agent_idx!=root_agent_idx && !executed[parent_agent_idx]) {
-                        execute_agent(parent_agent_idx,root_agent_idx);
-                    }
-                    // parent anget must be excuted now.
-                    if (parent_agent_idx==root_agent_idx || (*next_states)[parent_agent_idx].location!=(*curr_states)[parent_agent_idx].location) {
-                        // if we have a loop or parent agent also forwards, then we can foward as well
-                        next_state.location=planned_next_state.location;
-                        next_state.orientation=curr_state.orientation;
-                        next_state.timestep=curr_state.timestep+1;
-                    } else {
-                        // if parent agent still stays, then we need to wait
-                        next_state.location=curr_state.location;
-                        if (planned_next_state.orientation!=-1) {
-                            next_state.orientation=planned_next_state.orientation;
-                        } else {
-                            next_state.orientation=curr_state.orientation;
-                        }
-                        next_state.timestep=curr_state.timestep+1;
-                    }
-                } else {
-                    // if empty, then readily to forward
+                if (parent_moves) {
+                    // if the next location is empty, we have a loop or parent agent also forwards, then we can foward as well
                     next_state.location=planned_next_state.location;
                     next_state.orientation=curr_state.orientation;
                     next_state.timestep=curr_state.timestep+1;
+                } else {
+                    // if parent agent still stays, then we need to wait
+                    next_state.location=curr_state.location;
+                    if (planned_next_state.orientation!=-1) {
+                        next_state.orientation=planned_next_state.orientation;
+                    } else {
+                        next_state.orientation=curr_state.orientation;
+                    }
+                    next_state.timestep=curr_state.timestep+1;
                 }
             } else {
                 // we need to rotate
@@ -119,8 +175,6 @@ public:
                 next_state.timestep=curr_state.timestep+1;
             }
         }
-
-        executed[agent_idx]=true;
     }
 
     int get_neighbor_orientation(int loc1,int loc2) {
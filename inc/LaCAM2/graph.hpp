@@ -4,6 +4,7 @@
 #pragma once
 #include "LaCAM2/utils.hpp"
 #include "SharedEnv.h"
+#include <cstdint>
 
 namespace LaCAM2 {
 
@@ -17,42 +18,75 @@ struct Vertex {
 using Vertices = std::vector<Vertex*>;
 // using Config = std::vector<Vertex*>;  // a set of locations for all agents
 
+// zobrist key of agent i at (loc, orient), mixed on the fly instead of a table of N x |V| x 4 keys.
+inline uint64_t zobrist_key(uint64_t i, uint64_t loc, uint64_t orient) {
+  uint64_t z = (i << 40) ^ (loc << 8) ^ orient;
+  z += 0x9e3779b97f4a7c15ULL;
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+// a configuration, stored as arrays of compact values.
+// locs are Vertex::index (use G.U to get the vertex), arrivals are packed bits.
+// write through set() and set_arrival() so that the hash stays consistent.
 struct Config {
-  std::vector<Vertex*> locs;
-  std::vector<int> orients;
-  std::vector<bool> arrivals;
+  static constexpr uint32_t NIL_LOC = UINT32_MAX;
+  static constexpr uint8_t NIL_ORIENT = UINT8_MAX;
+
+  std::vector<uint32_t> locs;
+  std::vector<uint8_t> orients;
+  std::vector<uint64_t> arrival_bits;
+  uint64_t hash;  // xor of the zobrist keys of all agents
 
   Config(int N) {
-    locs.resize(N, nullptr);
-    orients.resize(N, -1);
-    arrivals.resize(N, false);
+    locs.resize(N, NIL_LOC);
+    orients.resize(N, NIL_ORIENT);
+    arrival_bits.resize((N + 63) / 64, 0);
+    hash = 0;
+    for (int i=0;i<N;++i) hash ^= zobrist_key(i, NIL_LOC, NIL_ORIENT);
   }
 
   inline size_t size() const {
     return locs.size();
   };
 
-  
+  inline void set(uint i, uint32_t loc, int orient) {
+    hash ^= zobrist_key(i, locs[i], orients[i]) ^ zobrist_key(i, loc, (uint8_t)orient);
+    locs[i] = loc;
+    orients[i] = (uint8_t)orient;
+  }
+
+  inline bool arrived(uint i) const {
+    return (arrival_bits[i >> 6] >> (i & 63)) & 1;
+  }
+
+  inline void set_arrival(uint i, bool arrived) {
+    if (this->arrived(i) == arrived) return;
+    arrival_bits[i >> 6] ^= 1ULL << (i & 63);
+    // NIL_LOC never appears with an orientation, so the key does not collide with a location key.
+    hash ^= zobrist_key(i, NIL_LOC, 0);
+  }
+
   inline bool all_arrived() const {
-    for (int i=0;i<arrivals.size();++i) {
-      if (!arrivals[i]) return false;
+    const size_t N = size();
+    for (size_t k=0;k<arrival_bits.size();++k) {
+      uint64_t full = (k + 1) * 64 <= N ? ~0ULL : (1ULL << (N & 63)) - 1;
+      if (arrival_bits[k] != full) return false;
     }
     return true;
   }
 
+  inline bool operator==(const Config& other) const {
+    return hash == other.hash && locs == other.locs && orients == other.orients &&
+           arrival_bits == other.arrival_bits;
+  }
+
   struct ConfigEqual {
     bool operator()(const Config& C1, const Config& C2) const {
-        const auto N = C1.size();
-        for (size_t i = 0; i < N; ++i) {
-          if (C1.locs[i]->id != C2.locs[i]->id) return false;
-          if (C1.orients[i] != C2.orients[i]) return false;
-          if (C1.arrivals[i] != C2.arrivals[i]) return false;
-        }
-        return true;
+      return C1 == C2;
     }
   };
-
-
 };
 
 struct Graph {
@@ -73,11 +107,9 @@ bool is_same_config(
     const Config& C1,
     const Config& C2);  // check equivalence of two configurations
 
-// hash function of configuration
-// c.f.
-// https://stackoverflow.com/questions/10405030/c-unordered-map-fail-when-used-with-a-vector-as-key
+// hash function of configuration, maintained incrementally by Config
 struct ConfigHasher {
-  uint operator()(const Config& C) const;
+  size_t operator()(const Config& C) const { return C.hash; }
 };
 
 std::ostream& operator<<(std::ostream& os, const Vertex* v);
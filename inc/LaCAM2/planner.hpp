@@ -9,7 +9,10 @@
 #include "LaCAM2/utils.hpp"
 #include "util/HeuristicTable.h"
 #include <memory>
+#include <atomic>
+#include <functional>
 #include "LaCAM2/executor.hpp"
+#include "LaCAM2/arena.hpp"
 
 namespace LaCAM2 {
 
@@ -27,23 +30,62 @@ struct Agent {
 };
 using Agents = std::vector<Agent*>;
 
-// low-level node
+// agents at the vertices. clear() is O(1): it bumps the generation, and a cell is only valid
+// if it was written in the current generation.
+struct Occupancy {
+  std::vector<Agent*> agents;
+  std::vector<uint> stamps;
+  uint gen = 1;
+
+  Occupancy(size_t n) : agents(n, nullptr), stamps(n, 0) {}
+  inline Agent* operator[](size_t v) const { return stamps[v] == gen ? agents[v] : nullptr; }
+  inline void set(size_t v, Agent* a) { stamps[v] = gen; agents[v] = a; }
+  inline void reset(size_t v) { stamps[v] = 0; }
+  inline void clear() {
+    if (++gen == 0) {  // wrapped around
+      std::fill(stamps.begin(), stamps.end(), 0);
+      gen = 1;
+    }
+  }
+};
+
+// low-level node: one constraint on top of its parent's, so a child costs O(1).
+// the constraints of a node are the chain up to the root, which has none.
 struct LNode {
-  std::vector<uint> who;
-  std::vector<std::tuple<Vertex*,int > > where; // vertex and orientation
+  LNode* parent;
+  uint who;
+  Vertex* where;
+  int orient;
   const uint depth;
   LNode(LNode* parent, uint i, const std::tuple<Vertex*,int > & t);  // who and where
-  LNode(): who(), where(), depth(0) {}
+  LNode(): parent(nullptr), who(0), where(nullptr), orient(-1), depth(0) {}
+};
+
+// priority of an agent when ordering a high-level node
+struct AgentScore {
+  bool disabled;
+  bool arrived;
+  bool precomputed;
+  float elapse;
+  float h;
+  float tie_breaker;
+  int id;
+
+  bool operator==(const AgentScore & other) const {
+    return disabled==other.disabled && arrived==other.arrived && precomputed==other.precomputed
+      && elapse==other.elapse && h==other.h && tie_breaker==other.tie_breaker && id==other.id;
+  }
 };
+bool agent_score_less(const AgentScore & s1, const AgentScore & s2, int order_strategy);
 
 // high-level node
 struct HNode {
-  static uint HNODE_CNT;  // count #(high-level node)
+  static std::atomic<uint> HNODE_CNT;  // count #(high-level node)
   const Config C;
 
   // tree
   HNode* parent;
-  std::set<HNode*> neighbor;
+  std::set<HNode*, std::less<HNode*>, ArenaAllocator<HNode*> > neighbor;
 
   uint d;        // depth (might be updated, it might be different from g)
 
@@ -53,21 +95,53 @@ struct HNode {
   float f;        // g + h (might be updated)
 
   // for low-level search
-  std::vector<float> priorities;
-  std::vector<uint> order;
-  std::queue<LNode*> search_tree;
+  std::vector<uint, ArenaAllocator<uint> > order;
+  // scores of the agents when the node was created, indexed by agent id
+  std::vector<AgentScore, ArenaAllocator<AgentScore> > scores;
+  std::queue<LNode*, std::deque<LNode*, ArenaAllocator<LNode*> > > search_tree;
   
   int order_strategy;
 
+  // nodes are created in the arena of the planner and destroyed when it is reset.
   HNode(const Config& _C, const std::shared_ptr<HeuristicTable> & HT, Instance * ins, HNode* _parent, float _g,
-        float _h, const uint _d, int order_strategy, bool disable_agent_goals);
-  ~HNode();
+        float _h, const uint _d, int order_strategy, bool disable_agent_goals, Arena * arena);
 };
 using HNodes = std::vector<HNode*>;
 
+// explored configurations: open addressing with linear probing on Config::hash.
+// a windowed search stops at a fixed depth, so the same configuration at another depth is another node there.
+// then the nodes are keyed by (configuration, depth), which also keeps the depths valid when rewiring.
+struct ExploredTable {
+  std::vector<std::pair<uint64_t, HNode*> > slots;  // nullptr for empty slots
+  size_t num = 0;
+  bool by_depth;
+
+  explicit ExploredTable(bool by_depth = false, size_t capacity = 1024);
+  HNode* find(const Config& C, int d) const;
+  void insert(HNode* H);  // H must not be in the table
+  size_t size() const { return num; }
+
+private:
+  inline uint64_t key(const Config& C, int d) const
+  {
+    return by_depth ? C.hash ^ ((uint64_t)d * 0x9E3779B97F4A7C15ULL) : C.hash;
+  }
+  void grow();
+};
+
 struct Planner {
   Instance* ins;
   const Deadline* deadline;
+  // optional bound shared by the planners of a portfolio: the best cost by eval_solution so far.
+  // bound_g_weight*g+bound_h_weight*h of a node is a lower bound of that cost for every solution through it,
+  // so the nodes that cannot beat the bound are dropped and the planner stops once none is left.
+  const std::atomic<float>* cost_bound = nullptr;
+  float bound_g_weight = 0;
+  float bound_h_weight = 0;
+  // anytime: keep refining after the first solution until the deadline or the search is exhausted.
+  bool anytime = false;
+  // called with every new or improved solution and its cost.
+  std::function<void(const Solution&, float)> on_solution;
   std::mt19937* MT;
   const int verbose;
   bool use_swap;  // use swap operation or not
@@ -90,8 +164,27 @@ struct Planner {
   std::vector<std::array<Vertex*, 5> > C_next;  // next locations, used in PIBT
   std::vector<float> tie_breakers;              // random values, used in PIBT
   Agents A;
-  Agents occupied_now;                          // for quick collision checking
-  Agents occupied_next;                         // for quick collision checking
+  Occupancy occupied_now;                       // for quick collision checking
+  Occupancy occupied_next;                      // for quick collision checking
+  HNode* H_occupied;                            // node that occupied_now is built for
+  Agents moved;                                 // agents whose v_next is set since the last get_new_config
+
+  // partitioned PIBT: the vertices are cut into pibt_tiles bands of consecutive rows. in every one of pibt_slices
+  // slices of the priority order, the agents inside the bands are planned in parallel, then the rest sequentially.
+  // push chains that reach an agent at a band border are undone and left to the sequential pass. 0 or 1 disables it.
+  int pibt_tiles = 0;
+  int pibt_slices = 8;
+  std::vector<int> tile_of;                     // band of each vertex
+  std::vector<bool> tile_border;                // vertex with a neighbor in another band
+  std::vector<std::vector<uint> > tile_agents;  // agents planned in each band, in priority order
+  std::vector<Agents> tile_moved;               // moved, per band
+  std::vector<char> tile_deferred;              // the current push chain of a band hit a border agent
+
+  // time spent in get_new_config, only measured in the dev mode
+  double get_new_config_ms = 0;
+  uint get_new_config_cnt = 0;
+  // nodes dropped by the cost bound of the portfolio
+  uint bound_pruned_cnt = 0;
 
   bool disable_agent_goals;
 
@@ -105,14 +198,19 @@ struct Planner {
           bool use_swap=false,
           bool use_orient_in_heuristic=false,
           bool use_external_executor=false,
-          bool disable_agent_goals=true);
+          bool disable_agent_goals=true,
+          Arena * arena=nullptr);
   ~Planner();
 
   Executor executor;
 
-  Solution solve(std::string& additional_info, int order_strategy);
+  // memory of all nodes in a search, it can be shared by the planners of successive calls.
+  Arena own_arena;
+  Arena * arena;
 
-  std::vector<std::tuple<Vertex *,int> > get_successors(Vertex *v, int orient);
+  Solution solve(std::string& additional_info, int order_strategy);
+  Solution backtrack(HNode* H_goal);
+  void update_goal(HNode* H, HNode*& H_goal);
 
   void expand_lowlevel_tree(HNode* H, LNode* L);
   void rewrite(HNode* H_from, HNode* T, HNode* H_goal,
@@ -121,7 +219,10 @@ struct Planner {
   float get_edge_cost(HNode* H_from, HNode* H_to);
   float get_h_value(const Config& C);
   bool get_new_config(HNode* H, LNode* L);
-  bool funcPIBT(Agent* ai, HNode * H);
+  // tile>=0 plans inside that band without the swap operation, so bands can run concurrently.
+  bool funcPIBT(Agent* ai, HNode * H, int tile = -1);
+  bool funcPIBT_tiles(HNode* H, size_t first, size_t last);  // the inner agents in H->order[first, last)
+  void setup_tiles();
 
   // swap operation
   Agent* swap_possible_and_required(Agent* ai);
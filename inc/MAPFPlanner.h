@@ -55,6 +55,10 @@ public:
     nlohmann::json config;
     void load_configs();
     std::string load_map_weights(string weights_path);
+    std::shared_ptr<HeuristicTable> build_heuristics(bool consider_rotation, const std::string & suffix);
+    std::shared_ptr<HeuristicTable> heuristics;
+    // only used by the lazy heuristics
+    bool prefetch_heuristics=false;
 
     RHCR::MAPFSolver* rhcr_build_mapf_solver(nlohmann::json & config, RHCR::CompetitionGraph & graph);
     void rhcr_config_solver(std::shared_ptr<RHCR::RHCRSolver> & solver,nlohmann::json & config);
@@ -13,20 +13,88 @@
 #include "util/MyLogger.h"
 #include "boost/format.hpp"
 #include "util/SearchForHeuristics/SpatialSearch.h"
+#include "util/SearchForHeuristics/BitParallelBFS.h"
+#include "util/StateGraph.h"
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <unordered_set>
+#include <thread>
 // #include "bshoshany/BS_thread_pool.hpp"
 
 
 #define MAX_HEURISTIC FLT_MAX/16
 
+#define HEURISTIC_FILE_MAGIC "LRRHEU\0\0"
+#define HEURISTIC_FILE_VERSION 2
+
+// memory layout flags of the tables in the uncompressed cache file
+enum HeuristicLayout { HL_FLOAT_START_MAJOR=0, HL_QUANTIZED=1, HL_GOAL_MAJOR=2 };
+
+#define MAX_QUANTIZED_MAIN (UINT16_MAX-1)
+#define MAX_QUANTIZED_SUB (UINT8_MAX-1)
+
+// header of the uncompressed heuristic cache, which can be mmapped directly.
+// every section starts at a page-aligned offset of the file.
+struct HeuristicFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t layout;
+    uint64_t rows;
+    uint64_t cols;
+    uint64_t loc_size;
+    uint64_t n_orientations;
+    // hash of the map and the weights the tables were computed with.
+    uint64_t weights_hash;
+    float main_scale;
+    float sub_scale;
+    uint64_t empty_locs_offset;
+    uint64_t main_offset;
+    uint64_t sub_offset;
+    uint64_t file_size;
+};
+
+// a changed entry of the map weights, dir 4 is rotation (or wait).
+struct WeightChange {
+    int loc_idx;
+    int dir;
+    float old_weight;
+    float new_weight;
+};
+
+// control block of a shared-memory table, it lives in the first page right after the header.
+struct HeuristicShmControl {
+    std::atomic<uint32_t> ready;
+    std::atomic<int32_t> refcount;
+    int32_t creator_pid;
+};
+
+#define HEURISTIC_SHM_CONTROL_OFFSET ((sizeof(HeuristicFileHeader)+63)/64*64)
+// how long attachers wait for the creator of a segment to resize it and write its pid.
+#define HEURISTIC_SHM_INIT_TIMEOUT_MS 5000
+
 class HeuristicTable {
 public:
 
     const SharedEnvironment & env;
     CompetitionActionModelWithRotate action_model;
     // loc1, loc2
-    float * main_heuristics;
+    float * main_heuristics=nullptr;
     // loc1, loc2, orient1, orient2
-    float * sub_heuristics;
+    float * sub_heuristics=nullptr;
+    // quantized storage: main distances are q*main_scale (UINT16_MAX means unreachable),
+    // sub heuristics are deltas q*sub_scale to the main value. both are rounded down, so the heuristics stay admissible.
+    bool quantized=false;
+    // goal-major layout: main is indexed by [loc_idx2*loc_size+loc_idx1] and sub by [(loc_idx2*loc_size+loc_idx1)*n_orientations+orient1],
+    // so all sources towards one goal are contiguous.
+    bool goal_major=false;
+    // use the avx2 gathers in get_many if the cpu supports them.
+    bool use_simd=true;
+    uint16_t * main_heuristics_q=nullptr;
+    uint8_t * sub_heuristics_q=nullptr;
+    float main_scale=1;
+    float sub_scale=1;
     int * empty_locs;
     int * loc_idxs; 
     int n_orientations=4;
@@ -35,10 +103,95 @@ public:
     bool consider_rotation=true;
 
     std::shared_ptr<std::vector<float> > map_weights;
+    // successors of the (location, orientation) states, shared by the planners that use these heuristics.
+    std::shared_ptr<StateGraph> state_graph;
+
+    // if not null, the tables point into this mmapped cache file instead of heap arrays.
+    void * mmap_addr=nullptr;
+    size_t mmap_size=0;
+    // write the uncompressed cache after computing or loading the .gz file.
+    bool save_mmap_cache=false;
+    // share the tables between processes on the same map and weights through POSIX shared memory.
+    // the first process publishes them, later ones attach to the same pages.
+    bool use_shared_memory=false;
+    string shm_name;
+    int shm_fd=-1;
+    void * shm_addr=nullptr;
+    size_t shm_size=0;
+    HeuristicShmControl * shm_control=nullptr;
+    // our slot in the registry of shared tables of this process, -1 if not registered.
+    int shm_slot=-1;
+
+    // async mode: preprocess returns right away and a background thread computes the tables.
+    // rows not published yet are answered by an admissible fallback from get_fallback.
+    bool async_build=false;
+    std::thread build_thread;
+    // start loc_idx -> whether its row is computed
+    std::atomic<uint8_t> * row_ready=nullptr;
+    std::atomic<bool> build_done{true};
+    std::atomic<bool> stop_build{false};
+    float min_move_weight=1;
+    float min_rotate_weight=1;
+
+    // use the bit-parallel bfs instead of one search per location if all weights are the same.
+    bool use_bit_parallel_bfs=true;
+    // auto, binary_heap, dial or radix_heap
+    string open_list="auto";
+    UTIL::SPATIAL::OpenListType open_list_type=UTIL::SPATIAL::OL_BINARY_HEAP;
+    int max_weight=1;
+
+    // lazy mode: instead of the all-pairs tables, rows rooted at goals are computed by a
+    // reverse search on the first query and kept in a memory-capped LRU cache.
+    bool lazy=false;
+    size_t lazy_cache_mb=1024;
+    size_t max_cached_rows=0;
+    size_t n_cached_rows=0;
+    // a row is main[loc_size] followed by sub[state_size] if considering rotation.
+    size_t row_size=0;
+    float * cached_rows=nullptr;
+    // goal loc_idx -> slot, -1 if not cached
+    std::atomic<int> * row_of_goal=nullptr;
+    // slot -> goal loc_idx
+    std::atomic<int> * goal_of_row=nullptr;
+    // seqlock of each slot, odd while its row is being replaced. a hit takes no lock: it reads the row between
+    // two loads of the version and falls back to a miss if the version changed or the slot has another goal.
+    std::atomic<uint32_t> * row_version=nullptr;
+    // approximate lru: the clock counts the installed rows and a hit stamps its row with the current count,
+    // so the rows used since the last install are equally recent.
+    std::atomic<uint64_t> * row_last_used=nullptr;
+    std::atomic<uint64_t> row_clock{0};
+    // serializes the installs only.
+    std::mutex rows_mutex;
+    // goals whose rows are being computed. the other threads missing on them wait instead of searching again.
+    std::mutex pending_mutex;
+    std::condition_variable pending_cv;
+    std::unordered_set<int> pending_goals;
+    std::mutex planners_mutex;
+    std::vector<UTIL::SPATIAL::SpatialAStar *> free_planners;
+
+    // landmark mode: lower bounds from the triangle inequality over K landmarks on the location graph,
+    // which takes O(K*V) memory. it is built on top of the lazy mode: goals with cached rows are exact.
+    bool use_landmarks=false;
+    int n_landmarks=16;
+    bool landmark_exact_cache=true;
+    std::vector<int> landmarks;
+    // loc_idx*n_landmarks+k: cost from landmark k to loc, and from loc to landmark k.
+    float * landmark_dists_from=nullptr;
+    float * landmark_dists_to=nullptr;
 
     HeuristicTable(SharedEnvironment * _env, const std::shared_ptr<std::vector<float> > & map_weights, bool consider_rotation=true);
     ~HeuristicTable();
 
+    void alloc_tables();
+    bool weights_are_integral();
+    bool has_uniform_weights(float & weight);
+    void select_open_list();
+    UTIL::SPATIAL::SpatialAStar * new_planner(int n_orients);
+    void quantize_main_heuristics();
+    inline uint8_t quantize_sub(float diff) {
+        return (uint8_t)std::min((float)MAX_QUANTIZED_SUB,std::floor(diff/sub_scale));
+    }
+
     // weights is an array of [loc_size*n_orientations]
     void compute_weighted_heuristics();
 
@@ -48,8 +201,51 @@ public:
         UTIL::SPATIAL::SpatialAStar * planner
     );
 
+    void compute_uniform_heuristics(float weight);
+    void transpose_tables();
+
+    void publish_rows(int start_loc_idx, int n_rows);
+    void start_async_build(const string & mmap_fpath);
+    void wait_for_build();
+    float get_fallback(int loc_idx1, int orient1, int loc_idx2);
+
+    // repair the tables for new weights of the same map instead of recomputing everything.
+    // it rewrites map_weights, the state_graph edges and the tables in place without any lock,
+    // so the caller must not run it while a planner may read them, i.e. only between planning steps.
+    // test/heuristic_update.cpp checks it against tables recomputed from scratch.
+    void update_weights(const std::vector<float> & new_weights);
+    int neighbor_loc_idx(int loc_idx, int dir);
+    void get_state_predecessors(int state, const std::vector<float> & weights, std::vector<std::pair<int,float> > & preds);
+    void find_affected_rows(
+        const std::vector<WeightChange> & changes,
+        const std::vector<float> & new_weights,
+        std::vector<char> & affected
+    );
+    void repair_location_row(
+        int start_loc_idx,
+        const std::vector<WeightChange> & changes,
+        const std::vector<float> & old_weights,
+        std::vector<char> & invalid
+    );
+    void clear_lazy_cache();
+
     void dump_main_heuristics(int start_loc, string file_path_prefix);
 
+    void init_lazy_cache();
+    void compute_goal_row(int goal_loc_idx, float * row);
+    int install_goal_row(int goal_loc_idx, const float * row);
+    // a cached row without locking, false on a miss.
+    bool find_cached(int loc_idx1, int orient1, int loc_idx2, float & h);
+    // compute and install the row of the goal, unless another thread is computing it. then it waits for that
+    // thread and returns false.
+    bool build_goal_row(int goal_loc_idx, float * row);
+    float get_lazy(int loc_idx1, int orient1, int loc_idx2);
+    // compute rows of the given goal locations in advance, e.g. for revealed tasks.
+    void prefetch(const std::vector<int> & goals);
+
+    void compute_landmarks();
+    float get_landmark_bound(int loc_idx1, int loc_idx2);
+
     // void compute_heuristics();
 
     // void _push(State * queue, State &s, int & e_idx);
@@ -66,10 +262,37 @@ public:
     // TODO add check
     float get(int loc1, int loc2);
     float get(int loc1, int orient1, int loc2);
+    // batched lookups of many sources towards one goal, orients can be null to ignore the start orientations.
+    void get_many(const int * locs, const int * orients, int goal, float * out, int n);
+    // the same with a goal per source.
+    void get_many(const int * locs, const int * orients, const int * goals, float * out, int n);
+    void get_many_avx2(const int * locs, const int * orients, int goal_loc_idx, float * out, int n);
+    void get_many_avx2(const int * locs, const int * orients, const int * goals, float * out, int n);
+    inline size_t main_index(size_t loc_idx1, size_t loc_idx2) {
+        return goal_major?loc_idx2*loc_size+loc_idx1:loc_idx1*loc_size+loc_idx2;
+    }
     // int get(int loc1, int orient1, int loc2, int orient2);
 
     // void preprocess();
     void preprocess(string suffix="");
     void save(const string & fpath);
     void load(const string & fpath);
+
+    uint64_t compute_weights_hash();
+    HeuristicFileHeader make_file_header();
+    void save_mmap(const string & fpath);
+    bool load_mmap(const string & fpath);
+    bool check_file_header(const HeuristicFileHeader & header, const HeuristicFileHeader & expected);
+
+    string make_shm_name(const string & fname);
+    int open_shm(const string & name);
+    int attach_shm(int fd, const string & name);
+    void publish_shm();
+    // drop our reference to the shared tables, the last user removes the segment.
+    // a process killed by SIGKILL never drops its reference, so the segment stays until it is removed by hand,
+    // e.g. rm /dev/shm/lrr_heuristics_*. later processes still attach to it, as its name is keyed by the map and the weights.
+    void release_shm();
+    // the drivers leave with _exit, so they release the shared tables of all live heuristics explicitly.
+    // it takes no locks and may be called from a signal handler.
+    static void release_all_shm();
 };
\ No newline at end of file
@@ -0,0 +1,63 @@
+#pragma once
+#include <cstdint>
+
+// the philox4x32-10 counter-based generator (salmon et al., parallel random numbers: as easy as 1, 2, 3).
+// the n-th number of a stream only depends on (seed, stream, n), so each thread can draw from its own stream
+// and every run reproduces the same numbers. it is a UniformRandomBitGenerator, e.g. for std::shuffle.
+class Philox {
+public:
+    typedef uint32_t result_type;
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return UINT32_MAX; }
+
+    explicit Philox(uint64_t seed=0, uint64_t stream=0) {
+        this->seed(seed,stream);
+    }
+
+    void seed(uint64_t seed, uint64_t stream=0) {
+        key[0]=(uint32_t)seed;
+        key[1]=(uint32_t)(seed>>32);
+        counter[0]=0;
+        counter[1]=0;
+        counter[2]=(uint32_t)stream;
+        counter[3]=(uint32_t)(stream>>32);
+        idx=4;
+    }
+
+    inline result_type operator()() {
+        if (idx==4) {
+            generate();
+            idx=0;
+        }
+        return block[idx++];
+    }
+
+private:
+    uint32_t key[2];
+    uint32_t counter[4]; // a 64-bit block counter, then the stream
+    uint32_t block[4];
+    int idx;
+
+    void generate() {
+        uint32_t x0=counter[0],x1=counter[1],x2=counter[2],x3=counter[3];
+        uint32_t k0=key[0],k1=key[1];
+        for (int r=0;r<10;++r) {
+            if (r>0) {
+                k0+=0x9E3779B9;
+                k1+=0xBB67AE85;
+            }
+            uint64_t p0=(uint64_t)0xD2511F53*x0;
+            uint64_t p1=(uint64_t)0xCD9E8D57*x2;
+            x0=(uint32_t)(p1>>32)^x1^k0;
+            x1=(uint32_t)p1;
+            x2=(uint32_t)(p0>>32)^x3^k1;
+            x3=(uint32_t)p0;
+        }
+        block[0]=x0;
+        block[1]=x1;
+        block[2]=x2;
+        block[3]=x3;
+        if (++counter[0]==0)
+            ++counter[1];
+    }
+};
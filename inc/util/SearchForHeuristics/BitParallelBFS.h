@@ -0,0 +1,157 @@
+#pragma once
+#include "SharedEnv.h"
+#include <cstdint>
+#include <vector>
+#include <iostream>
+
+namespace UTIL {
+
+namespace SPATIAL {
+
+// breadth-first search for many sources at once when all actions cost the same.
+// every state keeps a bitset of lanes, a lane is a (source, start orientation) pair,
+// and a level expands the frontier bitsets of all lanes together by pulling from predecessors.
+template <int NW>
+class BitParallelBFS {
+public:
+    static const int n_lanes=64*NW;
+
+    BitParallelBFS(
+        const SharedEnvironment & env, int n_orients, const int * empty_locs, const int * loc_idxs, int loc_size
+    ): env(env), n_orients(n_orients), loc_size(loc_size) {
+        n_states=loc_size*n_orients;
+        build_predecessors(empty_locs,loc_idxs);
+        visited.resize((size_t)n_states*NW);
+        frontier.resize((size_t)n_states*NW);
+        next_frontier.resize((size_t)n_states*NW);
+        loc_visited.resize((size_t)loc_size*NW);
+    }
+
+    const SharedEnvironment & env;
+    int n_orients;
+    int loc_size;
+    int n_states;
+
+    // predecessors of state loc_idx*n_orients+orient in CSR form
+    std::vector<int> pred_offsets;
+    std::vector<int> preds;
+
+    std::vector<uint64_t> visited;
+    std::vector<uint64_t> frontier;
+    std::vector<uint64_t> next_frontier;
+    std::vector<uint64_t> loc_visited;
+
+    void build_predecessors(const int * empty_locs, const int * loc_idxs) {
+        pred_offsets.assign(n_states+1,0);
+        preds.clear();
+        // E,S,W,N
+        const int dxs[4]={1,0,-1,0};
+        const int dys[4]={0,1,0,-1};
+        for (int loc_idx=0;loc_idx<loc_size;++loc_idx) {
+            int pos=empty_locs[loc_idx];
+            int x=pos%env.cols;
+            int y=pos/env.cols;
+            for (int orient=0;orient<n_orients;++orient) {
+                for (int dir=0;dir<4;++dir) {
+                    // with rotation, we can only move forward along the current orientation.
+                    if (n_orients>1 && dir!=orient)
+                        continue;
+                    int px=x-dxs[dir];
+                    int py=y-dys[dir];
+                    if (px<0 || px>=env.cols || py<0 || py>=env.rows)
+                        continue;
+                    int prev_loc_idx=loc_idxs[py*env.cols+px];
+                    if (prev_loc_idx==-1)
+                        continue;
+                    preds.push_back(prev_loc_idx*n_orients+orient);
+                }
+                if (n_orients>1) {
+                    preds.push_back(loc_idx*n_orients+(orient-1+n_orients)%n_orients);
+                    preds.push_back(loc_idx*n_orients+(orient+1)%n_orients);
+                }
+                pred_offsets[loc_idx*n_orients+orient+1]=(int)preds.size();
+            }
+        }
+    }
+
+    // lane i searches from source_loc_idxs[i/n_orients] with start orientation i%n_orients.
+    // on_reach(lane, loc_idx, level) is called on the first level a lane reaches a location with any orientation.
+    template <typename F>
+    void search(const int * source_loc_idxs, int n_sources, F && on_reach) {
+        if (n_sources*n_orients>n_lanes) {
+            std::cerr<<"too many sources for the bit-parallel bfs: "<<n_sources<<std::endl;
+            exit(-1);
+        }
+
+        std::fill(visited.begin(),visited.end(),0);
+        std::fill(frontier.begin(),frontier.end(),0);
+        std::fill(loc_visited.begin(),loc_visited.end(),0);
+
+        for (int i=0;i<n_sources;++i) {
+            int loc_idx=source_loc_idxs[i];
+            for (int orient=0;orient<n_orients;++orient) {
+                int lane=i*n_orients+orient;
+                uint64_t bit=1ULL<<(lane%64);
+                size_t idx=(size_t)(loc_idx*n_orients+orient)*NW+lane/64;
+                visited[idx]|=bit;
+                frontier[idx]|=bit;
+                loc_visited[(size_t)loc_idx*NW+lane/64]|=bit;
+                on_reach(lane,loc_idx,0);
+            }
+        }
+
+        int level=0;
+        bool any=true;
+        while (any) {
+            ++level;
+            any=false;
+            for (int loc_idx=0;loc_idx<loc_size;++loc_idx) {
+                uint64_t new_loc[NW]={0};
+                for (int orient=0;orient<n_orients;++orient) {
+                    int state=loc_idx*n_orients+orient;
+                    uint64_t acc[NW]={0};
+                    for (int i=pred_offsets[state];i<pred_offsets[state+1];++i) {
+                        const uint64_t * f=frontier.data()+(size_t)preds[i]*NW;
+                        for (int w=0;w<NW;++w) {
+                            acc[w]|=f[w];
+                        }
+                    }
+                    uint64_t * v=visited.data()+(size_t)state*NW;
+                    uint64_t * nf=next_frontier.data()+(size_t)state*NW;
+                    for (int w=0;w<NW;++w) {
+                        uint64_t fresh=acc[w]&~v[w];
+                        v[w]|=fresh;
+                        nf[w]=fresh;
+                        new_loc[w]|=fresh;
+                    }
+                }
+
+                uint64_t * lv=loc_visited.data()+(size_t)loc_idx*NW;
+                for (int w=0;w<NW;++w) {
+                    uint64_t fresh=new_loc[w]&~lv[w];
+                    if (new_loc[w]) {
+                        any=true;
+                    }
+                    lv[w]|=fresh;
+                    while (fresh) {
+                        int b=__builtin_ctzll(fresh);
+                        on_reach(w*64+b,loc_idx,level);
+                        fresh&=fresh-1;
+                    }
+                }
+            }
+            frontier.swap(next_frontier);
+        }
+    }
+};
+
+// 256 lanes per search if the word loops can be vectorized with AVX2, otherwise 64.
+#ifdef __AVX2__
+typedef BitParallelBFS<4> DefaultBitParallelBFS;
+#else
+typedef BitParallelBFS<1> DefaultBitParallelBFS;
+#endif
+
+} // namespace SPATIAL
+
+} // namespace UTIL
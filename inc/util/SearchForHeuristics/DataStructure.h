@@ -2,6 +2,9 @@
 #include "util/SearchForHeuristics/SpatialState.h"
 #include <iostream>
 #include <random>
+#include <vector>
+#include <cstring>
+#include <cstdint>
 
 namespace UTIL {
 namespace SPATIAL {
@@ -119,5 +122,166 @@ public:
 
 };
 
+enum OpenListType { OL_BINARY_HEAP, OL_DIAL, OL_RADIX_HEAP };
+
+// Dial's bucket queue for integral costs, keyed by g. it is only valid for searches without h.
+// decrease-key pushes the state again, stale entries are skipped when they reach the front.
+class DialQueue {
+public:
+    std::vector<std::vector<State *> > buckets;
+    long curr_key;
+    int size;
+
+    // costs of pushed states are within [curr_key, curr_key+max_weight]
+    DialQueue(int max_weight): buckets(max_weight+1), curr_key(0), size(0) {};
+
+    inline bool is_stale(State * s, long key) {
+        return s->closed || (long)s->g!=key;
+    }
+
+    void push(State * s) {
+        buckets[(long)s->g%buckets.size()].push_back(s);
+        ++size;
+    }
+
+    // move to the first valid entry, dropping stale ones on the way.
+    inline bool empty() {
+        while (size>0) {
+            auto & bucket=buckets[curr_key%buckets.size()];
+            if (bucket.empty()) {
+                ++curr_key;
+                continue;
+            }
+            if (is_stale(bucket.back(),curr_key)) {
+                bucket.pop_back();
+                --size;
+                continue;
+            }
+            return false;
+        }
+        return true;
+    }
+
+    // must be called after empty() returns false.
+    State * pop() {
+        auto & bucket=buckets[curr_key%buckets.size()];
+        State * ret=bucket.back();
+        bucket.pop_back();
+        --size;
+        return ret;
+    }
+
+    void increase(State * s) {
+        push(s);
+    }
+
+    void clear() {
+        for (auto & bucket: buckets) {
+            bucket.clear();
+        }
+        curr_key=0;
+        size=0;
+    }
+};
+
+// radix heap over the bits of non-negative float costs, which sort like unsigned integers.
+// it needs monotone keys, so it is also only valid for searches without h.
+class RadixHeap {
+public:
+    typedef std::pair<uint32_t,State *> Entry;
+    std::vector<Entry> buckets[33];
+    std::vector<Entry> scratch;
+    uint32_t last_key;
+    int size;
+
+    RadixHeap(): last_key(0), size(0) {};
+
+    static inline uint32_t to_key(float g) {
+        uint32_t key;
+        memcpy(&key,&g,sizeof(key));
+        return key;
+    }
+
+    inline int bucket_index(uint32_t key) {
+        return key==last_key?0:32-__builtin_clz(key^last_key);
+    }
+
+    void push(State * s) {
+        uint32_t key=to_key(s->g);
+        buckets[bucket_index(key)].emplace_back(key,s);
+        ++size;
+    }
+
+    inline bool is_stale(const Entry & e) {
+        return e.second->closed || e.first!=to_key(e.second->g);
+    }
+
+    // refill bucket 0 from the first non-empty bucket, dropping stale entries on the way.
+    inline bool empty() {
+        while (size>0) {
+            auto & bucket0=buckets[0];
+            while (!bucket0.empty() && is_stale(bucket0.back())) {
+                bucket0.pop_back();
+                --size;
+            }
+            if (!bucket0.empty()) {
+                return false;
+            }
+
+            int i=1;
+            while (i<33 && buckets[i].empty()) {
+                ++i;
+            }
+            if (i==33) {
+                break;
+            }
+
+            uint32_t min_key=UINT32_MAX;
+            for (auto & e: buckets[i]) {
+                if (!is_stale(e)) {
+                    min_key=std::min(min_key,e.first);
+                }
+            }
+            if (min_key==UINT32_MAX) {
+                size-=(int)buckets[i].size();
+                buckets[i].clear();
+                continue;
+            }
+
+            last_key=min_key;
+            scratch.swap(buckets[i]);
+            for (auto & e: scratch) {
+                if (is_stale(e)) {
+                    --size;
+                } else {
+                    buckets[bucket_index(e.first)].push_back(e);
+                }
+            }
+            scratch.clear();
+        }
+        return true;
+    }
+
+    // must be called after empty() returns false.
+    State * pop() {
+        State * ret=buckets[0].back().second;
+        buckets[0].pop_back();
+        --size;
+        return ret;
+    }
+
+    void increase(State * s) {
+        push(s);
+    }
+
+    void clear() {
+        for (auto & bucket: buckets) {
+            bucket.clear();
+        }
+        last_key=0;
+        size=0;
+    }
+};
+
+}
 }
-}
\ No newline at end of file
@@ -11,12 +11,19 @@ namespace SPATIAL {
 class SpatialAStar {
 
 public:
+    // max_weight is only used by the Dial queue, it must bound the cost of every action.
     SpatialAStar(
-        const SharedEnvironment & env, int n_orients, const std::vector<float> & weights
-    ): env(env), n_orients(n_orients), weights(weights) {
+        const SharedEnvironment & env, int n_orients, const std::vector<float> & weights,
+        OpenListType open_list_type=OL_BINARY_HEAP, int max_weight=1
+    ): env(env), n_orients(n_orients), weights(weights), open_list_type(open_list_type) {
         max_states=env.rows*env.cols*n_orients;
         n_states=0;
         open_list = new OpenList(max_states);
+        if (open_list_type==OL_DIAL) {
+            dial_list = new DialQueue(max_weight);
+        } else if (open_list_type==OL_RADIX_HEAP) {
+            radix_list = new RadixHeap();
+        }
         all_states = new State[max_states];
         max_successors=8;
         successors = new State[max_successors];
@@ -25,6 +32,8 @@ public:
 
     void reset() {
         open_list->clear();
+        if (dial_list!=nullptr) dial_list->clear();
+        if (radix_list!=nullptr) radix_list->clear();
         n_states=0;
         for (int i=0;i<max_states;++i) {
             if (all_states[i].pos!=-1) {
@@ -41,6 +50,8 @@ public:
 
     ~SpatialAStar() {
         delete open_list;
+        delete dial_list;
+        delete radix_list;
         delete [] all_states;
         delete [] successors;
     }
@@ -49,6 +60,10 @@ public:
     int n_states;
     int max_states;
     OpenList* open_list;
+    // bucket queues, only for searches without h, i.e. search_for_all.
+    OpenListType open_list_type;
+    DialQueue * dial_list=nullptr;
+    RadixHeap * radix_list=nullptr;
     State * all_states;
     const int n_dirs=5; // right,down,left,up,stay
 
@@ -189,6 +204,65 @@ public:
         }
     }
 
+    // the reverse of get_successors: states that can reach curr with one action.
+    void get_predecessors(State * curr) {
+        clear_successors();
+        int pos=curr->pos;
+        int x=pos%(env.cols);
+        int y=pos/(env.cols);
+        if (curr->orient==-1) {
+            // from west, moving east
+            if (x-1>=0 && env.map[pos-1]==0) {
+                add_successor(pos-1, -1, curr->g+weights[(pos-1)*n_dirs], 0, curr);
+            }
+
+            // from north, moving south
+            if (y-1>=0 && env.map[pos-env.cols]==0) {
+                add_successor(pos-env.cols, -1, curr->g+weights[(pos-env.cols)*n_dirs+1], 0, curr);
+            }
+
+            // from east, moving west
+            if (x+1<env.cols && env.map[pos+1]==0) {
+                add_successor(pos+1, -1, curr->g+weights[(pos+1)*n_dirs+2], 0, curr);
+            }
+
+            // from south, moving north
+            if (y+1<env.rows && env.map[pos+env.cols]==0) {
+                add_successor(pos+env.cols, -1, curr->g+weights[(pos+env.cols)*n_dirs+3], 0, curr);
+            }
+        } else {
+            int orient=curr->orient;
+
+            // FW: the previous location is behind us along the current orientation
+            int prev_pos=-1;
+            if (orient==0) {
+                if (x-1>=0) prev_pos=pos-1;
+            } else if (orient==1) {
+                if (y-1>=0) prev_pos=pos-env.cols;
+            } else if (orient==2) {
+                if (x+1<env.cols) prev_pos=pos+1;
+            } else if (orient==3) {
+                if (y+1<env.rows) prev_pos=pos+env.cols;
+            } else {
+                std::cerr<<"spatial search in heuristics: invalid orient: "<<orient<<endl;
+                exit(-1);
+            }
+            if (prev_pos!=-1 && env.map[prev_pos]==0) {
+                add_successor(prev_pos, orient, curr->g+weights[prev_pos*n_dirs+orient], 0, curr);
+            }
+
+            int weight_idx=pos*n_dirs+4;
+            // CR from the previous orientation
+            add_successor(pos, (orient-1+n_orients)%n_orients, curr->g+weights[weight_idx], 0, curr);
+
+            // CCR from the next orientation
+            add_successor(pos, (orient+1+n_orients)%n_orients, curr->g+weights[weight_idx], 0, curr);
+
+            // W
+            add_successor(pos, orient, curr->g+weights[weight_idx], 0, curr);
+        }
+    }
+
     State * add_state(int pos, int orient, float g, float h, State * prev) {
         int index;
         if (orient==-1) {
@@ -216,14 +290,58 @@ public:
 
     void search_for_all(int start_pos, int start_orient) {
         State * start=add_state(start_pos, start_orient, 0, 0, nullptr);
-        open_list->push(start);
+        push_start(start);
+        expand_all(false);
+    }
 
-        while (!open_list->empty()) {
-            State * curr=open_list->pop();
+    // costs from all states to the goal location with any orientation, or only with goal_orient.
+    void search_for_all_reverse(int goal_pos, int goal_orient=-1) {
+        if (n_orients==1) {
+            push_start(add_state(goal_pos, -1, 0, 0, nullptr));
+        } else if (goal_orient!=-1) {
+            push_start(add_state(goal_pos, goal_orient, 0, 0, nullptr));
+        } else {
+            for (int orient=0;orient<n_orients;++orient) {
+                push_start(add_state(goal_pos, orient, 0, 0, nullptr));
+            }
+        }
+        expand_all(true);
+    }
+
+    void push_start(State * s) {
+        // the bucket queues skip closed states as stale entries.
+        s->closed=false;
+        if (open_list_type==OL_DIAL) {
+            dial_list->push(s);
+        } else if (open_list_type==OL_RADIX_HEAP) {
+            radix_list->push(s);
+        } else {
+            open_list->push(s);
+        }
+    }
+
+    void expand_all(bool reverse) {
+        if (open_list_type==OL_DIAL) {
+            expand_all(dial_list,reverse);
+        } else if (open_list_type==OL_RADIX_HEAP) {
+            expand_all(radix_list,reverse);
+        } else {
+            expand_all(open_list,reverse);
+        }
+    }
+
+    template <class Queue>
+    void expand_all(Queue * queue, bool reverse) {
+        while (!queue->empty()) {
+            State * curr=queue->pop();
             curr->closed=true;
             // cerr<<curr->pos<<" "<<curr->orient<<" "<<curr->g<<" "<<curr->h<<endl;
 
-            get_successors(curr);
+            if (reverse) {
+                get_predecessors(curr);
+            } else {
+                get_successors(curr);
+            }
             for (int i=0;i<n_successors;++i) {
                 State * next=successors+i;
                 int index;
@@ -236,7 +354,7 @@ public:
                     // new state
                     State * new_state=add_state(next->pos, next->orient, next->g, next->h, next->prev);
                     new_state->closed=false;
-                    open_list->push(new_state);
+                    queue->push(new_state);
                 } else {
                     // old state
                     auto old_state=all_states+index;
@@ -245,9 +363,9 @@ public:
                         old_state->copy(next);
                         if (old_state->closed) {
                             old_state->closed=false;
-                            open_list->push(old_state);
+                            queue->push(old_state);
                         } else {
-                            open_list->increase(old_state);
+                            queue->increase(old_state);
                         }
                     }
                 }
@@ -0,0 +1,46 @@
+#pragma once
+#include "SharedEnv.h"
+#include "ActionModel.h"
+#include <vector>
+#include <cstdint>
+
+// an action from a (location, orientation) state.
+struct StateEdge {
+    int to_pos;
+    uint8_t to_orient;
+    uint8_t action; // Action: FW, CR, CCR or W
+    float weight;
+};
+
+// the state graph of the rotation action model over (location, orientation), compiled once into csr arrays.
+// state pos*n_orients+orient has its edges in [offsets[state], offsets[state+1]), in the order FW, CR, CCR, W.
+// blocked cells have no edges. weights come from map_weights: dir 0-3 for moves, dir 4 for rotations and waits.
+class StateGraph {
+public:
+    static const int n_orients=4;
+    static const int n_dirs=5;
+    static const int max_degree=4;
+
+    int rows;
+    int cols;
+    std::vector<uint32_t> offsets;
+    std::vector<StateEdge> edges;
+
+    struct Range {
+        const StateEdge * first;
+        const StateEdge * last;
+        inline const StateEdge * begin() const { return first; }
+        inline const StateEdge * end() const { return last; }
+        inline size_t size() const { return last-first; }
+    };
+
+    StateGraph(const SharedEnvironment & env, const std::vector<float> & map_weights);
+
+    // refresh the edge weights for new weights of the same map.
+    void update_weights(const std::vector<float> & map_weights);
+
+    inline Range successors(int pos, int orient) const {
+        const int state=pos*n_orients+orient;
+        return {edges.data()+offsets[state],edges.data()+offsets[state+1]};
+    }
+};
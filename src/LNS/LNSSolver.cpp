@@ -154,7 +154,7 @@ void LNSSolver::plan(const SharedEnvironment & env){
 
 
             // TODO: lacam2_solver should plan with starts differnt from env.curr_states but goals the same as env.goals because they are up-to-date. 
-            lacam2_solver->plan(env, &precomputed_paths, &starts, &goals);
+            lacam2_solver->plan(env, &precomputed_paths, &starts, &goals, (time_limit-time_limiter.get_elapse())*1000);
             // cout<<"lacam succeed"<<endl;
 
             // we need to copy the new planned paths into paths
@@ -165,7 +165,8 @@ void LNSSolver::plan(const SharedEnvironment & env){
             // }
             int num_inconsistent=0;
             for (int i=0;i<env.num_of_agents;++i){
-                for (int j=0;j<planning_paths[i].size()-1;++j){
+                // the lacam2 paths are shorter if it found no solution and all agents wait.
+                for (int j=0;j+1<planning_paths[i].size() && j<lacam2_solver->paths[i].size();++j){
                     if (planning_paths[i][j].location!=lacam2_solver->paths[i][j].location || planning_paths[i][j].orientation!=lacam2_solver->paths[i][j].orientation){
                         ++num_inconsistent;
                         break;
@@ -208,13 +209,16 @@ void LNSSolver::plan(const SharedEnvironment & env){
             0.01, // TODO: reaction factor
             read_param_json<string>(config,"initAlgo"),
             read_param_json<string>(config,"replanAlgo"),
-            false, // TODO: not sipp
+            read_param_json<bool>(config,"use_sipp",false), // "sipp" is set in every config but has never been used
             read_param_json<int>(config,"window_size_for_CT"),
             read_param_json<int>(config,"window_size_for_CAT"),
             read_param_json<int>(config,"window_size_for_PATH"),
             execution_window,
             lacam2_solver->max_agents_in_use!=env.num_of_agents, // TODO: has disabled agents
             read_param_json<bool>(config,"fix_ng_bug"),
+            read_param_json<bool>(config,"deterministic",false),
+            read_param_json<int>(config,"maxIterations",INT_MAX),
+            read_param_json<int>(config,"seed",0),
             0 // TODO: screen
         );
     }
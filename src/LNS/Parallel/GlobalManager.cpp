@@ -18,21 +18,17 @@ GlobalManager::GlobalManager(
     int window_size_for_CT, int window_size_for_CAT, int window_size_for_PATH, int execution_window,
     bool has_disabled_agents,
     bool fix_ng_bug,
+    bool deterministic, int max_iterations, int seed,
     int screen
 ): 
-    async(async),
-    instance(instance), path_table(instance.map_size,window_size_for_PATH), HT(HT), map_weights(map_weights),
+    async(async), deterministic(deterministic), max_iterations(max_iterations),
+    instance(instance), shared_path_table(instance.map_size,window_size_for_PATH,instance.num_of_agents,get_num_threads()),
+    path_table(instance.map_size,window_size_for_PATH), HT(HT), map_weights(map_weights),
     init_algo_name(init_algo_name), replan_algo_name(replan_algo_name),
     window_size_for_CT(window_size_for_CT), window_size_for_CAT(window_size_for_CAT), window_size_for_PATH(window_size_for_PATH),
     screen(screen), agent_infos(agent_infos), has_disabled_agents(has_disabled_agents) {
 
-    char * num_threads_env = std::getenv("LNS_NUM_THREADS");
-    if (num_threads_env!=nullptr) {
-        num_threads=std::atoi(num_threads_env);
-    } else {
-        num_threads=omp_get_max_threads();
-    }
-
+    num_threads=get_num_threads();
     omp_set_num_threads(num_threads);
 
     cout<<"LNS use "<<num_threads<<" threads"<<endl;
@@ -47,6 +43,7 @@ GlobalManager::GlobalManager(
     for (int i=0;i<instance.num_of_agents;++i) {
         agents.emplace_back(i,instance,HT,agent_infos);
     }
+    path_table.setBase(&shared_path_table, instance.num_of_agents);
 
     // cout<<num_threads<<endl;
     // exit(-1);
@@ -57,7 +54,8 @@ GlobalManager::GlobalManager(
             replan_algo_name, sipp,
             window_size_for_CT, window_size_for_CAT, window_size_for_PATH, execution_window,
             has_disabled_agents,
-            screen, i*2023+1
+            screen, seed,
+            &shared_path_table, i
         );
         local_optimizers.push_back(local_optimizer);
     }
@@ -67,7 +65,7 @@ GlobalManager::GlobalManager(
             instance, HT, path_table, agents, agent_infos,
             neighbor_size, destroy_strategy, 
             ALNS, decay_factor, reaction_factor, 
-            num_threads, fix_ng_bug, screen, 0
+            num_threads, fix_ng_bug, screen, seed
         );
     } else {
         for (auto i=0;i<num_threads;++i) {
@@ -75,18 +73,21 @@ GlobalManager::GlobalManager(
                 instance, HT, local_optimizers[i]->path_table, local_optimizers[i]->agents, agent_infos,
                 neighbor_size, destroy_strategy, 
                 ALNS, decay_factor, reaction_factor, 
-                num_threads, fix_ng_bug, screen, i*2023+1314
+                num_threads, fix_ng_bug, screen, seed
             );
             neighbor_generators.push_back(neighbor_generator);
         }
-        updating_queues.resize(num_threads);
-        updating_queue_locks.resize(num_threads);
-        for (auto & lock: updating_queue_locks) {
-            omp_init_lock(&lock);
-        }
     }
 }
 
+int GlobalManager::get_num_threads() {
+    char * num_threads_env = std::getenv("LNS_NUM_THREADS");
+    if (num_threads_env!=nullptr) {
+        return std::atoi(num_threads_env);
+    }
+    return omp_get_max_threads();
+}
+
 void GlobalManager::reset() {
     initial_sum_of_costs=MAX_COST;
     sum_of_costs=MAX_COST;
@@ -95,6 +96,7 @@ void GlobalManager::reset() {
     sum_of_distances=0;
 
     iteration_stats.clear();
+    shared_path_table.reset();
     path_table.reset();
     for (auto & agent: agents) {
         agent.reset();
@@ -108,11 +110,6 @@ void GlobalManager::reset() {
         for (auto & neighbor_generator: neighbor_generators) {
             neighbor_generator->reset();
         }
-        for (int i=0;i<num_threads;++i) {
-            omp_set_lock(&(updating_queue_locks[i]));
-            updating_queues[i].clear();
-            omp_unset_lock(&(updating_queue_locks[i]));
-        }
     }
 
     // call reset of local_optimizers
@@ -124,11 +121,6 @@ void GlobalManager::reset() {
 }
 
 GlobalManager::~GlobalManager() {
-    if (async) {
-        for (auto & lock: updating_queue_locks) {
-            omp_destroy_lock(&lock);
-        }
-    }
 }
 
 void GlobalManager::update(Neighbor & neighbor, bool recheck) {
@@ -201,31 +193,41 @@ void GlobalManager::update(Neighbor & neighbor, bool recheck) {
     }
 }
 
-void GlobalManager::update(Neighbor & neighbor) {
-    // apply update
-    g_timer.record_p("path_table_delete_s");
-    for (auto & aid: neighbor.agents) {
-        bool verbose=false;
-        // if (neighbor.agents.size()<10){
-        //     verbose=true;
-        // } 
-        path_table.deletePath(aid, neighbor.m_old_paths[aid],verbose);
+void GlobalManager::commit(NeighborGenerator & generator, Neighbor & neighbor, TimeLimiter & time_limiter) {
+    if (time_limiter.timeout())
+        return;
+    // update alns
+    generator.update(neighbor);
+
+    if (time_limiter.timeout())
+        return;
+    update(neighbor,true);
+
+    if (time_limiter.timeout())
+        return;
+    if (!neighbor.succ) {
+        ++num_of_failures;
     }
-    g_timer.record_d("path_table_delete_s","path_table_delete");
 
-    // std::cerr<<std::endl;
-    g_timer.record_p("path_table_insert_s");
+    double elapse=time_limiter.get_elapse();
+    if (screen >= 1)
+        cout << "Iteration " << iteration_stats.size() << ", "
+            << "group size = " << neighbor.agents.size() << ", "
+            << "solution cost = " << sum_of_costs << ", "
+            << "remaining time = " << time_limiter.time_limit-elapse << endl;
+    iteration_stats.emplace_back(neighbor.agents.size(), sum_of_costs, elapse, replan_algo_name);
+}
+
+void GlobalManager::update(Neighbor & neighbor) {
+    // apply update
+    g_timer.record_p("path_table_commit_s");
     for (auto & aid: neighbor.agents) {
         // update agents' paths here
         agents[aid].path = neighbor.m_paths[aid];
-        bool verbose=false;
-        // if (neighbor.agents.size()<10){
-        //     verbose=true;
-        // } 
-        // update path table here
-        path_table.insertPath(aid, neighbor.m_paths[aid],verbose);
     }
-    g_timer.record_d("path_table_insert_s","path_table_insert");
+    // update path table here, the local optimizers see it at their next sync
+    shared_path_table.commit(neighbor);
+    g_timer.record_d("path_table_commit_s","path_table_commit");
 
         // std::cerr<<std::endl;
     // update costs here
@@ -267,14 +269,6 @@ bool GlobalManager::_run_async(TimeLimiter & time_limiter) {
 
     update(init_neighbor,false);
 
-    // synchonize to local optimizer
-    ONLYDEV(g_timer.record_p("init_loc_opt_update_s");)
-    #pragma omp parallel for
-    for (int i=0;i<num_threads;++i) {
-        local_optimizers[i]->update(init_neighbor);
-    }
-    ONLYDEV(g_timer.record_d("init_loc_opt_update_s","init_loc_opt_update");)
-
     bool runtime=g_timer.record_d("lns_init_sol_s","lns_init_sol");
 
     elapse=time_limiter.get_elapse();
@@ -298,101 +292,75 @@ bool GlobalManager::_run_async(TimeLimiter & time_limiter) {
 
     //std::cout<<"num_threads: "<<num_threads<<" "<<neighbor_generators.size()<<std::endl;
 
-
-    #pragma omp parallel for
-    for (int i=0;i<num_threads;++i) {
-        int thread_id=omp_get_thread_num();
-        int ctr=0;
-
-        while (true) {
-            // if (ctr==1) {
-            //     break;
-            // }
-            ++ctr;
-            if (time_limiter.timeout())
-                break;
-
-            // 1. generate neighbor
-            Neighbor neighbor=neighbor_generators[i]->generate(time_limiter,i);
-                // for (auto aid:neighbor.agents) {
-                //     cout<<aid<<" ";
-                // }
-                // cout<<endl;
+    if (deterministic) {
+        std::vector<Neighbor> round_neighbors(num_threads);
+        while (!time_limiter.timeout() && (int)iteration_stats.size()-1<max_iterations) {
+            #pragma omp parallel for
+            for (int i=0;i<num_threads;++i) {
+                local_optimizers[i]->sync();
+                round_neighbors[i]=neighbor_generators[i]->generate(time_limiter,i);
+                if (!time_limiter.timeout())
+                    local_optimizers[i]->optimize(round_neighbors[i], time_limiter);
+                local_optimizers[i]->release();
+            }
+            // a round cut by the time limit is dropped as a whole
             if (time_limiter.timeout())
                 break;
 
-            // 2. optimize the neighbor
-            // auto & neighbor_ptr=neighbor_generators[i]->neighbors[i];
-            // auto & neighbor=*neighbor_ptr;
-            // #pragma omp critical
-            // {
-            //     for (auto aid: neighbor.agents) {
-            //         if (aid<0||aid>instance.num_of_agents) {
-            //             cout<<"thread id "<<thread_id<<" "<<i<<" invalid agent id "<<aid<<endl;
-            //         }
-            //     }
-            // }
-
-            local_optimizers[i]->optimize(neighbor, time_limiter);
-            if (time_limiter.timeout())
-                break;
+            for (int i=0;i<num_threads && (int)iteration_stats.size()-1<max_iterations;++i) {
+                commit(*neighbor_generators[i], round_neighbors[i], time_limiter);
+            }
+        }
+    } else {
+        #pragma omp parallel for
+        for (int i=0;i<num_threads;++i) {
+            int thread_id=omp_get_thread_num();
+            int ctr=0;
 
-            // cout<<"optimized"<<endl;
+            while (true) {
+                // if (ctr==1) {
+                //     break;
+                // }
+                ++ctr;
+                if (time_limiter.timeout())
+                    break;
 
-            // 3. update path table, statistics & maybe adjust strategies
-            #pragma omp critical
-            {
-                // for (int i=0;i<1;++i) {
-                    // if (time_limiter.timeout())
-                    //     break;
+                // synchonize to local optimizer
+                local_optimizers[i]->sync();
 
-                    // update alns
-                    // auto & neighbor_ptr=neighbor_generators[i]->neighbors[i];
-                    // auto & neighbor=*neighbor_ptr;
-                    if (!time_limiter.timeout()){
-                        neighbor_generators[i]->update(neighbor);
-                    }
-                    // if (time_limiter.timeout())
-                    //     break;
+                // 1. generate neighbor
+                Neighbor neighbor=neighbor_generators[i]->generate(time_limiter,i);
+                    // for (auto aid:neighbor.agents) {
+                    //     cout<<aid<<" ";
+                    // }
+                    // cout<<endl;
+                if (time_limiter.timeout())
+                    break;
 
-                    if (!time_limiter.timeout()){
-                        update(neighbor,true);
-                    }
-                    // if (time_limiter.timeout())
-                    //     break;
-
-                    if (!time_limiter.timeout()){
-                        if (!neighbor.succ) {
-                            ++num_of_failures;
-                        } else {
-                            for (int j=0;j<num_threads;++j) {
-                                updating_queues[j].push_back(neighbor);
-                            }
-                        }
-
-                        local_optimizers[i]->updating_queue=updating_queues[i];
-                        updating_queues[i].clear();
-
-                        elapse=time_limiter.get_elapse();
-                        if (screen >= 1)
-                            cout << "Iteration " << iteration_stats.size() << ", "
-                                << "group size = " << neighbor.agents.size() << ", "
-                                << "solution cost = " << sum_of_costs << ", "
-                                << "remaining time = " << time_limiter.time_limit-elapse << endl;
-                        iteration_stats.emplace_back(neighbor.agents.size(), sum_of_costs, elapse, replan_algo_name);
-                    }
+                // 2. optimize the neighbor
+                // auto & neighbor_ptr=neighbor_generators[i]->neighbors[i];
+                // auto & neighbor=*neighbor_ptr;
+                // #pragma omp critical
+                // {
+                //     for (auto aid: neighbor.agents) {
+                //         if (aid<0||aid>instance.num_of_agents) {
+                //             cout<<"thread id "<<thread_id<<" "<<i<<" invalid agent id "<<aid<<endl;
+                //         }
+                //     }
                 // }
-            }
 
-            // synchonize to local optimizer
-            if (time_limiter.timeout())
-                break;
-            for (auto & _neighbor: local_optimizers[i]->updating_queue) {
+                local_optimizers[i]->optimize(neighbor, time_limiter);
+                local_optimizers[i]->release();
                 if (time_limiter.timeout())
                     break;
-                local_optimizers[i]->update(_neighbor);
+
+                // cout<<"optimized"<<endl;
+
+                // 3. update path table, statistics & maybe adjust strategies
+                #pragma omp critical
+                commit(*neighbor_generators[i], neighbor, time_limiter);
             }
-            local_optimizers[i]->updating_queue.clear();
+            local_optimizers[i]->release();
         }
     }
     g_timer.record_d("lns_opt_s","lns_opt");
@@ -441,13 +409,6 @@ bool GlobalManager::_run(TimeLimiter & time_limiter) {
     getInitialSolution(init_neighbor);
 
     update(init_neighbor,false);
-    // synchonize to local optimizer
-    ONLYDEV(g_timer.record_p("init_loc_opt_update_s");)
-    #pragma omp parallel for
-    for (int i=0;i<num_threads;++i) {
-        local_optimizers[i]->update(init_neighbor);
-    }
-    ONLYDEV(g_timer.record_d("init_loc_opt_update_s","init_loc_opt_update");)
         
 
     bool runtime=g_timer.record_d("lns_init_sol_s","lns_init_sol");
@@ -473,6 +434,8 @@ bool GlobalManager::_run(TimeLimiter & time_limiter) {
     while (true) {
         if (time_limiter.timeout())
             break;
+        if (deterministic && (int)iteration_stats.size()-1>=max_iterations)
+            break;
 
         // 1. generate neighbors
         g_timer.record_p("neighbor_generate_s");
@@ -495,7 +458,9 @@ bool GlobalManager::_run(TimeLimiter & time_limiter) {
             // cerr<<i<<" "<<neighbor_generator.neighbors[i]->agents.size()<<endl;
             auto & neighbor_ptr = neighbor_generator->neighbors[i];
             auto & neighbor = *neighbor_ptr;
+            local_optimizers[i]->sync();
             local_optimizers[i]->optimize(neighbor, time_limiter);
+            local_optimizers[i]->release();
         }
         g_timer.record_d("loc_opt_s","loc_opt");
 
@@ -528,14 +493,6 @@ bool GlobalManager::_run(TimeLimiter & time_limiter) {
             auto & neighbor=*neighbor_ptr;
             update(neighbor,true);
 
-            // synchonize to local optimizer
-            ONLYDEV(g_timer.record_p("loc_opt_update_s");)
-            #pragma omp parallel for
-            for (int i=0;i<num_threads;++i) {
-                local_optimizers[i]->update(neighbor);
-            }
-            ONLYDEV(g_timer.record_d("loc_opt_update_s","loc_opt_update");)
-
             if (!neighbor.succ) {
                 ++num_of_failures;
             } 
@@ -13,43 +13,53 @@ LocalOptimizer::LocalOptimizer(
     int window_size_for_CT, int window_size_for_CAT, int window_size_for_PATH, int execution_window,
     bool has_disabled_agents,
     int screen,
-    int random_seed
+    int random_seed,
+    MVCCPathTable * shared_path_table,
+    int reader
 ):
-    instance(instance), path_table(instance.map_size,window_size_for_CT), HT(HT), map_weights(map_weights), agent_infos(agent_infos),
+    instance(instance), shared_path_table(shared_path_table), reader(reader), synced_commit(shared_path_table->firstCommit()),
+    path_table(instance.map_size,window_size_for_CT), HT(HT), map_weights(map_weights), sipp(sipp), agent_infos(agent_infos),
     replan_algo_name(replan_algo_name),
     window_size_for_CT(window_size_for_CT), window_size_for_CAT(window_size_for_CAT), window_size_for_PATH(window_size_for_PATH),
     has_disabled_agents(has_disabled_agents),
-    screen(screen), MT(random_seed) {
+    screen(screen), MT(random_seed,2*reader+1) {
 
     // : for agent_id, we just use 0 to initialize the path planner. but we need to change it (also starts and goals) everytime before planning
-    path_planner = std::make_shared<TimeSpaceAStarPlanner>(instance, HT, map_weights, execution_window);
+    if (sipp) {
+        sipp_planner = std::make_shared<SIPPPlanner>(instance, HT, map_weights, execution_window);
+    } else {
+        path_planner = std::make_shared<TimeSpaceAStarPlanner>(instance, HT, map_weights, execution_window);
+    }
 
     for (int i=0;i<instance.num_of_agents;++i) {
         this->agents.emplace_back(i,instance,HT,agent_infos);
     }
 
+    path_table.setBase(shared_path_table, instance.num_of_agents);
 }
 
 void LocalOptimizer::reset() {
     path_table.reset();
+    synced_commit=shared_path_table->firstCommit();
     // for (auto & agent: agents) {
     //     agent.reset();
     // }
 }
 
-void LocalOptimizer::update(Neighbor & neighbor) {
-    if (neighbor.succ) {
-        for (auto & aid: neighbor.agents) {
-            path_table.deletePath(aid, neighbor.m_old_paths[aid]);
-        }
-
-        for (auto & aid: neighbor.agents) {
-            path_table.insertPath(aid, neighbor.m_paths[aid]);
-            agents[aid].path = neighbor.m_paths[aid];
+void LocalOptimizer::sync() {
+    path_table.snapshot=shared_path_table->acquire(reader);
+    for (auto c=synced_commit->next.load(std::memory_order_acquire); c!=nullptr && c->epoch<=path_table.snapshot; c=c->next.load(std::memory_order_acquire)) {
+        for (auto aid: c->agents) {
+            agents[aid].path=shared_path_table->getPath(aid, path_table.snapshot);
         }
+        synced_commit=c;
     }
 }
 
+void LocalOptimizer::release() {
+    shared_path_table->release(reader);
+}
+
 void LocalOptimizer::prepare(Neighbor & neighbor) {
     // store the neighbor information
     //ONLYDEV(g_timer.record_p("store_neighbor_info_s");)
@@ -61,7 +71,7 @@ void LocalOptimizer::prepare(Neighbor & neighbor) {
             neighbor.m_old_paths[aid] = agent.path;
         // path_table.deletePath(neighbor.agents[i], agent.path);
         neighbor.old_sum_of_costs += agent.path.path_cost;
-        path_table.deletePath(aid, neighbor.m_old_paths[aid]);
+        path_table.hide(aid);
     }   
 
     //ONLYDEV(g_timer.record_d("store_neighbor_info_s","store_neighbor_info_e","store_neighbor_info");)    
@@ -140,8 +150,13 @@ bool LocalOptimizer::runPP(Neighbor & neighbor, const TimeLimiter & time_limiter
                  << "Agent " << agents[id].id << endl;
         if (search_priority==1) {
             //ONLYDEV(g_timer.record_p("findPath_s");)
-            path_planner->findPath(start_pos,start_orient,goal_pos,constraint_table, time_limiter);
-            neighbor.m_paths[id] = path_planner->path;
+            if (sipp) {
+                sipp_planner->findPath(start_pos,start_orient,goal_pos,constraint_table, time_limiter);
+                neighbor.m_paths[id] = sipp_planner->path;
+            } else {
+                path_planner->findPath(start_pos,start_orient,goal_pos,constraint_table, time_limiter);
+                neighbor.m_paths[id] = path_planner->path;
+            }
             //ONLYDEV(g_timer.record_d("findPath_s","findPath_e","findPath");)
         } else if (search_priority==2) {
             std::cerr<<"not supported now, need double checks"<<std::endl;
@@ -195,11 +210,8 @@ bool LocalOptimizer::runPP(Neighbor & neighbor, const TimeLimiter & time_limiter
     }
 
     // restore old paths
-    if (!neighbor.m_old_paths.empty())
-    {
-        for (auto & aid : neighbor.agents) {
-            path_table.insertPath(aid, neighbor.m_old_paths[aid]);
-        }
+    for (auto & aid : neighbor.agents) {
+        path_table.unhide(aid);
     }
     //ONLYDEV(g_timer.record_d("run_pp_s","run_pp_e","run_pp");)
 
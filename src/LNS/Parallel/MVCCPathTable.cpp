@@ -0,0 +1,186 @@
+#include "LNS/Parallel/MVCCPathTable.h"
+
+namespace LNS {
+
+namespace Parallel {
+
+MVCCPathTable::MVCCPathTable(int map_size, int window_size, int num_of_agents, int num_of_readers):
+    map_size(map_size), window_size(window_size),
+    cells((size_t)(window_size+1)*map_size), paths(num_of_agents), readers(num_of_readers), last_commit(&commits) {
+    if (window_size<=0) {
+        std::cerr<<"shared path table requires a positive window size: "<<window_size<<std::endl;
+        exit(-1);
+    }
+}
+
+MVCCPathTable::~MVCCPathTable() {
+    reset();
+    for (auto v: free_cells) {
+        delete v;
+    }
+    for (auto v: free_paths) {
+        delete v;
+    }
+}
+
+uint64_t MVCCPathTable::acquire(int reader) {
+    // the writer may publish an epoch and collect between our load and our announcement,
+    // so the announcement only counts once the epoch is still the same after it.
+    auto & snapshot=readers[reader].snapshot;
+    uint64_t e=epoch.load();
+    while (true) {
+        snapshot.store(e);
+        uint64_t curr=epoch.load();
+        if (curr==e)
+            return e;
+        e=curr;
+    }
+}
+
+void MVCCPathTable::release(int reader) {
+    readers[reader].snapshot.store(LATEST);
+}
+
+const Path & MVCCPathTable::getPath(int agent, uint64_t snapshot) const {
+    static const Path empty_path{};
+    auto v=paths[agent].load(std::memory_order_acquire);
+    while (v!=nullptr && v->epoch>snapshot)
+        v=v->older;
+    return v!=nullptr ? v->path : empty_path;
+}
+
+void MVCCPathTable::pushCell(int loc, int t, int agent, int prev, uint64_t e) {
+    int idx=t*map_size+loc;
+    auto & cell=cells[idx];
+    CellVersion * v;
+    if (free_cells.empty()) {
+        v=new CellVersion;
+    } else {
+        v=free_cells.back();
+        free_cells.pop_back();
+    }
+    v->agent=agent;
+    v->prev=prev;
+    v->epoch=e;
+    v->older=cell.load(std::memory_order_relaxed);
+    if (v->older==nullptr)
+        touched_cells.push_back(idx);
+    cell.store(v,std::memory_order_release);
+    written_cells.emplace_back(e,idx);
+}
+
+void MVCCPathTable::commit(Neighbor & neighbor) {
+    uint64_t e=epoch.load(std::memory_order_relaxed)+1;
+
+    for (auto aid: neighbor.agents) {
+        auto & path=neighbor.m_old_paths[aid].nodes;
+        int T=min((int)path.size(),horizon());
+        for (int t=0;t<T;++t) {
+            if (getAgent(path[t].location,t,LATEST)==aid)
+                pushCell(path[t].location,t,NO_AGENT,-1,e);
+        }
+    }
+
+    for (auto aid: neighbor.agents) {
+        auto & path=neighbor.m_paths[aid].nodes;
+        int T=min((int)path.size(),horizon());
+        for (int t=0;t<T;++t) {
+            pushCell(path[t].location,t,aid,t>0?path[t-1].location:-1,e);
+        }
+
+        PathVersion * v;
+        if (free_paths.empty()) {
+            v=new PathVersion;
+        } else {
+            v=free_paths.back();
+            free_paths.pop_back();
+        }
+        v->path=neighbor.m_paths[aid];
+        v->epoch=e;
+        v->older=paths[aid].load(std::memory_order_relaxed);
+        if (v->older==nullptr)
+            touched_paths.push_back(aid);
+        paths[aid].store(v,std::memory_order_release);
+        written_paths.emplace_back(e,aid);
+    }
+
+    auto c=new Commit;
+    c->epoch=e;
+    c->agents=neighbor.agents;
+    last_commit->next.store(c,std::memory_order_release);
+    last_commit=c;
+
+    epoch.store(e);
+    collect();
+}
+
+// a reader walks a chain from the newest version and stops at the first one not newer than its snapshot.
+// no snapshot is older than min_snapshot, so the versions behind the first one not newer than it are unreachable.
+void MVCCPathTable::collect() {
+    uint64_t min_snapshot=epoch.load();
+    for (auto & reader: readers) {
+        min_snapshot=min(min_snapshot,reader.snapshot.load());
+    }
+
+    while (!written_cells.empty() && written_cells.front().first<=min_snapshot) {
+        auto v=cells[written_cells.front().second].load(std::memory_order_relaxed);
+        written_cells.pop_front();
+        while (v->epoch>min_snapshot)
+            v=v->older;
+        for (auto older=v->older;older!=nullptr;) {
+            auto next=older->older;
+            free_cells.push_back(older);
+            older=next;
+        }
+        v->older=nullptr;
+    }
+
+    while (!written_paths.empty() && written_paths.front().first<=min_snapshot) {
+        auto v=paths[written_paths.front().second].load(std::memory_order_relaxed);
+        written_paths.pop_front();
+        while (v->epoch>min_snapshot)
+            v=v->older;
+        for (auto older=v->older;older!=nullptr;) {
+            auto next=older->older;
+            free_paths.push_back(older);
+            older=next;
+        }
+        v->older=nullptr;
+    }
+}
+
+void MVCCPathTable::reset() {
+    for (auto idx: touched_cells) {
+        for (auto v=cells[idx].load(std::memory_order_relaxed);v!=nullptr;) {
+            auto next=v->older;
+            free_cells.push_back(v);
+            v=next;
+        }
+        cells[idx].store(nullptr,std::memory_order_relaxed);
+    }
+    touched_cells.clear();
+    written_cells.clear();
+
+    for (auto aid: touched_paths) {
+        for (auto v=paths[aid].load(std::memory_order_relaxed);v!=nullptr;) {
+            auto next=v->older;
+            free_paths.push_back(v);
+            v=next;
+        }
+        paths[aid].store(nullptr,std::memory_order_relaxed);
+    }
+    touched_paths.clear();
+    written_paths.clear();
+
+    for (auto c=commits.next.load(std::memory_order_relaxed);c!=nullptr;) {
+        auto next=c->next.load(std::memory_order_relaxed);
+        delete c;
+        c=next;
+    }
+    commits.next.store(nullptr,std::memory_order_relaxed);
+    last_commit=&commits;
+}
+
+}
+
+}
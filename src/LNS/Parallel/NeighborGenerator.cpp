@@ -20,7 +20,7 @@ NeighborGenerator::NeighborGenerator(
     agents(agents), agent_infos(agent_infos),
     neighbor_size(neighbor_size), destroy_strategy(destroy_strategy),
     ALNS(ALNS), decay_factor(decay_factor), reaction_factor(reaction_factor),
-    num_threads(num_threads), fix_ng_bug(fix_ng_bug), screen(screen), MT(random_seed) {
+    num_threads(num_threads), fix_ng_bug(fix_ng_bug), screen(screen) {
 
     destroy_weights.assign(DESTORY_COUNT,1);
 
@@ -35,6 +35,10 @@ NeighborGenerator::NeighborGenerator(
 
     tabu_list_list.resize(num_threads);
     neighbors.resize(num_threads);
+    // thread i generates from stream 2*i, its local optimizer uses 2*i+1
+    for (int i=0;i<num_threads;++i) {
+        MTs.emplace_back(random_seed,2*i);
+    }
 
 }
 
@@ -66,7 +70,6 @@ void NeighborGenerator::update(Neighbor & neighbor){
 }
 
 void NeighborGenerator::generate_parallel(const TimeLimiter & time_limiter) {
-    // : since here we use parallel, we need a random seed generator that support parallelization, that is why we only could use rand() but not rand(), but we can fix this later.
     #pragma omp parallel for
     for (int i = 0; i < num_threads; i++) {
         generate(time_limiter,i);
@@ -79,15 +82,17 @@ Neighbor NeighborGenerator::generate(const TimeLimiter & time_limiter,int idx) {
     //Neighbor neighbor;
     // cout<<"start generate neighbor"<<endl;
     bool succ=false;
+    // a local copy, the indices may run concurrently
+    destroy_heuristic strategy=destroy_strategy;
     while (!succ){
         if (time_limiter.timeout())
             break;
 
         if (ALNS)
-            chooseDestroyHeuristicbyALNS();
+            strategy=chooseDestroyHeuristicbyALNS(idx);
 
         // ONLYDEV(g_timer.record_p("generate_neighbor_s");)
-        switch (destroy_strategy)
+        switch (strategy)
         {
             case RANDOMWALK:
                 {
@@ -97,7 +102,7 @@ Neighbor NeighborGenerator::generate(const TimeLimiter & time_limiter,int idx) {
                 }
             case INTERSECTION:
                 {
-                    succ = generateNeighborByIntersection(neighbor);
+                    succ = generateNeighborByIntersection(neighbor,idx);
                     neighbor.selected_neighbor = 1;
                     break;
                 }
@@ -116,7 +121,7 @@ Neighbor NeighborGenerator::generate(const TimeLimiter & time_limiter,int idx) {
                 {
                     auto s=std::set<int>();
                     while (s.size()<neighbor_size) {
-                        s.insert(rand()%agents.size());
+                        s.insert(MTs[idx]()%agents.size());
                     }
                     for (auto i:s) {
                         neighbor.agents.push_back(i);
@@ -160,18 +165,18 @@ Neighbor NeighborGenerator::generate(const TimeLimiter & time_limiter,int idx) {
 
 }
 
-void NeighborGenerator::chooseDestroyHeuristicbyALNS() {
-    int selected_neighbor=rouletteWheel();
+destroy_heuristic NeighborGenerator::chooseDestroyHeuristicbyALNS(int idx) {
+    int selected_neighbor=rouletteWheel(idx);
     switch (selected_neighbor)
     {
-        case 0 : destroy_strategy = RANDOMWALK; break;
-        case 1 : destroy_strategy = INTERSECTION; break;
-        case 2 : destroy_strategy = RANDOMAGENTS; break;
+        case 0 : return RANDOMWALK;
+        case 1 : return INTERSECTION;
+        case 2 : return RANDOMAGENTS;
         default : cerr << "ERROR" << endl; exit(-1);
     }
 }
 
-int NeighborGenerator::rouletteWheel()
+int NeighborGenerator::rouletteWheel(int idx)
 {
     double sum = 0;
     for (const auto& h : destroy_weights)
@@ -183,7 +188,7 @@ int NeighborGenerator::rouletteWheel()
             cout << h / sum << ",";
         cout << endl;
     }
-    double r = (double) rand() / RAND_MAX;
+    double r = (double) MTs[idx]() / Philox::max();
     double threshold = destroy_weights[0];
     int selected_neighbor = 0;
     while (threshold < r * sum)
@@ -209,21 +214,21 @@ bool NeighborGenerator::generateNeighborByRandomWalk(Neighbor & neighbor, int id
     
     set<int> neighbors_set;
     neighbors_set.insert(a);
-    randomWalk(a, 0, neighbors_set, neighbor_size);
+    randomWalk(a, 0, neighbors_set, neighbor_size, idx);
 
     // : we iterate for at most 10 iterations (not shown in the pseudo-code) to 
     // address the situation where the agent density is too low for us to collect N agents
     int count = 0;
     while (neighbors_set.size() < neighbor_size && count < 10) {
-        int t = rand() % agents[a].path.size();
-        randomWalk(a, t, neighbors_set, neighbor_size);
+        int t = MTs[idx]() % agents[a].path.size();
+        randomWalk(a, t, neighbors_set, neighbor_size, idx);
         count++;
         // select the next agent randomly
-        int idx = rand() % neighbors_set.size();
+        int k = MTs[idx]() % neighbors_set.size();
         int i = 0;
         for (auto n : neighbors_set)
         {
-            if (i == idx)
+            if (i == k)
             {
                 a = i;
                 break;
@@ -258,12 +263,12 @@ bool NeighborGenerator::generateNeighborByRandomWalk(Neighbor & neighbor, int id
     return true;
 }
 
-bool NeighborGenerator::generateNeighborByIntersection(Neighbor & neighbor) {
+bool NeighborGenerator::generateNeighborByIntersection(Neighbor & neighbor, int idx) {
     set<int> neighbors_set;
     auto pt = intersections.begin();
-    std::advance(pt, rand() % intersections.size());
+    std::advance(pt, MTs[idx]() % intersections.size());
     int location = *pt;
-    path_table.get_agents(neighbors_set, neighbor_size, location);
+    path_table.get_agents(neighbors_set, neighbor_size, location, MTs[idx]);
     if (neighbors_set.size() < neighbor_size)
     {
         set<int> closed;
@@ -282,7 +287,7 @@ bool NeighborGenerator::generateNeighborByIntersection(Neighbor & neighbor) {
                 closed.insert(next);
                 if (instance.getDegree(next) >= 3)
                 {
-                    path_table.get_agents(neighbors_set, neighbor_size, next);
+                    path_table.get_agents(neighbors_set, neighbor_size, next, MTs[idx]);
                     if ((int) neighbors_set.size() == neighbor_size)
                         break;
                 }
@@ -292,7 +297,7 @@ bool NeighborGenerator::generateNeighborByIntersection(Neighbor & neighbor) {
     neighbor.agents.assign(neighbors_set.begin(), neighbors_set.end());
     if (neighbor.agents.size() > neighbor_size)
     {
-        std::shuffle(neighbor.agents.begin(), neighbor.agents.end(),MT);
+        std::shuffle(neighbor.agents.begin(), neighbor.agents.end(),MTs[idx]);
         neighbor.agents.resize(neighbor_size);
     }
     if (screen >= 2)
@@ -333,77 +338,8 @@ int NeighborGenerator::findMostDelayedAgent(int idx){
     return a;
 }
 
-std::list<std::pair<int,int> > NeighborGenerator::getSuccessors(int pos, int orient) {
-    std::list<std::pair<int,int> > successors;
-
-    int & cols=instance.num_of_cols;
-    int & rows=instance.num_of_rows;
-    auto & map=instance.my_map;
-
-    int x=pos%(cols);
-    int y=pos/(cols);
-
-    // FW
-    int next_pos;
-    int next_orient=orient;
-    if (orient==0) {
-        // east
-        if (x+1<cols){
-            next_pos=pos+1;
-            if (map[next_pos]==0) {
-                successors.emplace_back(next_pos,next_orient);
-            }
-        }
-    } else if (orient==1) {
-        // south
-        if (y+1<rows) {
-            next_pos=pos+cols;
-            if (map[next_pos]==0) {
-                successors.emplace_back(next_pos,next_orient);
-            }
-        }
-    } else if (orient==2) {
-        // west
-        if (x-1>=0) {
-            next_pos=pos-1;
-            if (map[next_pos]==0) {
-                successors.emplace_back(next_pos,next_orient);
-            }
-        }
-    } else if (orient==3) {
-        // north
-        if (y-1>=0) {
-            next_pos=pos-cols;
-            if (map[next_pos]==0) {
-                successors.emplace_back(next_pos,next_orient);
-            }
-        }
-    } else {
-        std::cerr<<"NeighborGenerator: invalid orient: "<<orient<<endl;
-        exit(-1);
-    }
-
-
-    // for actions that don't change the position
-    next_pos=pos;
-
-    // CR
-    next_orient=(orient+1+n_orients)%n_orients;
-    successors.emplace_back(next_pos, next_orient);
-
-    // CCR
-    next_orient=(orient-1+n_orients)%n_orients;
-    successors.emplace_back(next_pos, next_orient);
-
-    // W
-    next_orient=orient;
-    successors.emplace_back(next_pos, next_orient);
-    
-    return successors;
-}
-
 // a random walk with path that is shorter than upperbound and has conflicting with neighbor_size agents
-void NeighborGenerator::randomWalk(int agent_id, int start_timestep, set<int>& conflicting_agents, int neighbor_size)
+void NeighborGenerator::randomWalk(int agent_id, int start_timestep, set<int>& conflicting_agents, int neighbor_size, int idx)
 {
     auto & path = agents[agent_id].path;
     int loc = path[start_timestep].location;
@@ -415,15 +351,17 @@ void NeighborGenerator::randomWalk(int agent_id, int start_timestep, set<int>& c
         // int slack=1;
         for (int t = start_timestep; t < path.size(); ++t)
         {
-            auto successors=getSuccessors(loc,orient);
-            while (!successors.empty())
+            StateEdge successors[StateGraph::max_degree];
+            int n_successors=0;
+            for (auto & e: HT->state_graph->successors(loc,orient)) {
+                successors[n_successors++]=e;
+            }
+            while (n_successors>0)
             {
-                int step = rand() % successors.size();
-                auto iter = successors.begin();
-                advance(iter, step);
+                int step = MTs[idx]() % n_successors;
 
-                int next_loc = iter->first;
-                int next_orient = iter->second;
+                int next_loc = successors[step].to_pos;
+                int next_orient = successors[step].to_orient;
                 
                 float action_cost = agent.get_action_cost(loc, orient, next_loc, next_orient, HT);
                 float next_h_val = HT->get(next_loc, next_orient,instance.goal_locations[agent_id]);
@@ -437,9 +375,10 @@ void NeighborGenerator::randomWalk(int agent_id, int start_timestep, set<int>& c
                     partial_path_cost += action_cost;
                     break;
                 }
-                successors.erase(iter);
+                std::copy(successors+step+1, successors+n_successors, successors+step);
+                --n_successors;
             }
-            if (successors.empty() || conflicting_agents.size() >= neighbor_size)
+            if (n_successors==0 || conflicting_agents.size() >= neighbor_size)
                 break;
         }
     // } else {
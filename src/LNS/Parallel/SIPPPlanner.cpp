@@ -0,0 +1,224 @@
+#include "LNS/Parallel/SIPPPlanner.h"
+
+namespace LNS {
+
+namespace Parallel {
+
+SIPPPlanner::SIPPPlanner(Instance & instance, std::shared_ptr<HeuristicTable> HT, std::shared_ptr<vector<float> > weights, int execution_window): instance(instance), HT(HT), weights(weights), execution_window(execution_window), open_list(states) {};
+
+std::pair<int,int> SIPPPlanner::getIntervals(int pos, const ConstraintTable & constraint_table) {
+    if (cell_stamps[pos]!=stamp) {
+        cell_stamps[pos]=stamp;
+        cell_intervals[pos]=(int)intervals.size();
+
+        // the path table constrains the cell until window_size_for_CT, after that it is free until the end of the window.
+        const int window=constraint_table.window_size_for_PATH;
+        const int last=constraint_table.path_table_for_CT!=nullptr?min(window,constraint_table.window_size_for_CT):-1;
+        int first=-1;
+        for (int t=0;t<=last;++t) {
+            if (constraint_table.path_table_for_CT->constrained(pos,pos,t)) {
+                if (first>=0) {
+                    intervals.emplace_back(first,t);
+                    first=-1;
+                }
+            } else if (first<0) {
+                first=t;
+            }
+        }
+        if (last<window && first<0)
+            first=last+1;
+        if (first>=0)
+            intervals.emplace_back(first,window+1);
+
+        cell_num_intervals[pos]=(int)intervals.size()-cell_intervals[pos];
+    }
+    return {cell_intervals[pos],cell_num_intervals[pos]};
+}
+
+int SIPPPlanner::getNumOfConflictsForWait(int pos, int t_from, int t_to, const ConstraintTable & constraint_table) const {
+    int rst=0;
+    for (int t=t_from+1;t<=t_to;++t) {
+        rst+=constraint_table.getNumOfConflictsForStep(pos, pos, t);
+    }
+    return rst;
+}
+
+void SIPPPlanner::findPath(int start_pos, int start_orient, int goal_pos, ConstraintTable & constraint_table, const TimeLimiter & time_limiter) {
+    clear();
+
+    if (cell_stamps.size()<(size_t)instance.map_size) {
+        cell_stamps.resize(instance.map_size,0);
+        cell_intervals.resize(instance.map_size);
+        cell_num_intervals.resize(instance.map_size);
+    }
+
+    const int window=constraint_table.window_size_for_PATH;
+    auto start_intervals=getIntervals(start_pos, constraint_table);
+    if (start_intervals.second==0 || intervals[start_intervals.first].first>0) {
+        // the start is occupied
+        return;
+    }
+
+    // at the beginning, we alway assume the agent havn't arrived its goal, even its start location are the same as the goal location. because we need at least length 2 path.
+    generate(start_pos, start_orient, 0, 0, HT->get(start_pos, start_orient, goal_pos), 0, false, -1, start_intervals.first, false);
+
+    while (!open_list.empty() && !time_limiter.timeout()) {
+
+        int curr=open_list.pop();
+        ++n_expanded;
+
+        // copy, states may grow below
+        const SIPPState s=states[curr];
+
+        if (execution_window==1 && s.pos==goal_pos && s.t>=1 && !constraint_table.constrained(s.pos, s.t)) {
+            buildPath(curr,goal_pos);
+            return;
+        }
+
+        if (s.t>=window) {
+            buildPath(curr,goal_pos);
+            return;
+        }
+
+        // the agent may wait here until end-1
+        const int end=intervals[s.interval].second;
+        const float wait_cost=getWaitCost(s.pos);
+
+        // wait until the end of the window
+        if (end>window) {
+            ++n_generated;
+            generate(
+                s.pos, s.orient, window, s.g+(float)(window-s.t)*wait_cost, s.h,
+                s.num_of_conflicts+getNumOfConflictsForWait(s.pos, s.t, window, constraint_table),
+                s.arrived | (s.pos==goal_pos), curr, s.interval, true
+            );
+        }
+
+        // wait a single step if it makes the agent arrive, i.e. it starts at its goal
+        if (!s.arrived && s.pos==goal_pos && s.t+1<end) {
+            ++n_generated;
+            generate(
+                s.pos, s.orient, s.t+1, s.g+wait_cost, s.h,
+                s.num_of_conflicts+constraint_table.getNumOfConflictsForStep(s.pos, s.pos, s.t+1),
+                true, curr, s.interval, false
+            );
+        }
+
+        // FW, CR and CCR, the waits are implicit
+        for (auto & e: HT->state_graph->successors(s.pos, s.orient)) {
+            if (e.action==W)
+                continue;
+            int next_pos=e.to_pos;
+
+            if (next_pos==s.pos) {
+                // rotating first and then waiting is never worse than the other way around
+                int t=s.t+1;
+                if (t>=end)
+                    continue;
+                ++n_generated;
+                float next_h=s.arrived?0:HT->get(next_pos, e.to_orient, goal_pos);
+                int next_num_of_conflicts=s.num_of_conflicts+constraint_table.getNumOfConflictsForStep(s.pos, next_pos, t);
+                generate(next_pos, e.to_orient, t, s.g+e.weight, next_h, next_num_of_conflicts, s.arrived, curr, s.interval, false);
+                continue;
+            }
+
+            auto next_intervals=getIntervals(next_pos, constraint_table);
+            for (int k=next_intervals.first;k<next_intervals.first+next_intervals.second;++k) {
+                // the earliest arrival in the interval, leaving the current one at t-1
+                int t=max(s.t+1,intervals[k].first);
+                if (t>end)
+                    break;
+                while (t<=end && t<intervals[k].second && constraint_table.path_table_for_CT->constrained(s.pos, next_pos, t))
+                    ++t;
+                if (t>end || t>=intervals[k].second)
+                    continue;
+
+                ++n_generated;
+                bool arrived=s.arrived | (s.pos==goal_pos && t-1>s.t);
+                float next_g=s.g+(float)(t-1-s.t)*wait_cost+e.weight;
+                float next_h=arrived?0:HT->get(next_pos, e.to_orient, goal_pos);
+                int next_num_of_conflicts=s.num_of_conflicts
+                    +getNumOfConflictsForWait(s.pos, s.t, t-1, constraint_table)
+                    +constraint_table.getNumOfConflictsForStep(s.pos, next_pos, t);
+                generate(next_pos, e.to_orient, t, next_g, next_h, next_num_of_conflicts, arrived | (next_pos==goal_pos), curr, k, false);
+            }
+        }
+    }
+}
+
+void SIPPPlanner::generate(int pos, int orient, int t, float g, float h, int num_of_conflicts, bool arrived, int prev, int interval, bool terminal) {
+    size_t key=(size_t)stateKey(interval, orient, arrived, terminal);
+    if (key>=stamps.size()) {
+        // the new entries have stamp 0, which is never the one of a search
+        stamps.resize(max(key+1,2*stamps.size()),0);
+        state_ids.resize(stamps.size());
+    }
+
+    if (stamps[key]!=stamp) {
+        // new state
+        stamps[key]=stamp;
+        state_ids[key]=(int)states.size();
+        states.push_back({{pos, orient, t, g, h, g+h, num_of_conflicts, arrived, prev, -1}, interval, terminal});
+        open_list.push((int)states.size()-1);
+        return;
+    }
+
+    // old state
+    int id=state_ids[key];
+    auto & old_state=states[id];
+    if (
+        num_of_conflicts<old_state.num_of_conflicts || (
+            num_of_conflicts==old_state.num_of_conflicts
+            && g+h<old_state.f
+        )
+    ) {
+        // we need to update the state
+        old_state.t=t;
+        old_state.g=g;
+        old_state.h=h;
+        old_state.f=g+h;
+        old_state.num_of_conflicts=num_of_conflicts;
+        old_state.prev=prev;
+        if (old_state.heap_index<0) {
+            // reopen closed state
+            open_list.push(id);
+        } else {
+            // update open state
+            open_list.increase(id);
+        }
+    }
+}
+
+void SIPPPlanner::clear() {
+    open_list.clear();
+    states.clear();
+    intervals.clear();
+    if (++stamp==0) {
+        std::fill(stamps.begin(), stamps.end(), 0);
+        std::fill(cell_stamps.begin(), cell_stamps.end(), 0);
+        stamp=1;
+    }
+    path.clear();
+    n_expanded = 0;
+    n_generated = 0;
+}
+
+void SIPPPlanner::buildPath(int curr, int goal_pos) {
+    path.clear();
+    path.path_cost = states[curr].f;
+
+    // the agent stays at each state until the time of the next one
+    int t=states[curr].t;
+    path.nodes.resize(t+1);
+    for (int id=curr;id!=-1;id=states[id].prev) {
+        auto & s=states[id];
+        for (;t>=s.t;--t) {
+            path.nodes[t].location=s.pos;
+            path.nodes[t].orientation=s.orient;
+        }
+    }
+}
+
+}
+
+} // namespace LNS
@@ -3,63 +3,97 @@
 
 namespace LNS {
 
-void PathTable::insertPath(int agent_id, const Path& _path, bool verbose)
+PathTable::PathTable(int map_size, int window_size): map_size(map_size), window_size(window_size), goals(map_size, MAX_TIMESTEP) {
+    if (map_size>0) {
+        if (window_size<=0) {
+            std::cerr<<"path table requires a positive window size: "<<window_size<<std::endl;
+            exit(-1);
+        }
+        table.resize((size_t)horizon()*map_size);
+    }
+}
+
+void PathTable::setBase(const Parallel::MVCCPathTable * base, int num_of_agents) {
+    // the view answers within its own window, e.g. window_size_for_CT, which may be shorter than the one of the base
+    if (base->horizon()<horizon()) {
+        std::cerr<<"path table has a longer window than its base: "<<window_size<<" vs "<<base->window_size<<std::endl;
+        exit(-1);
+    }
+    this->base=base;
+    hidden.assign(num_of_agents, false);
+}
+
+void PathTable::reset() {
+    for (auto idx: touched_cells) {
+        table[idx]=Cell();
+    }
+    touched_cells.clear();
+    for (auto loc: touched_goals) {
+        goals[loc]=MAX_TIMESTEP;
+    }
+    touched_goals.clear();
+    std::fill(hidden.begin(), hidden.end(), false);
+    makespan = 0;
+}
+
+void PathTable::setCell(int loc, int t, int agent_id, int prev) {
+    auto idx=t*map_size+loc;
+    auto & cell=table[idx];
+    if (cell.prev==UNTOUCHED) {
+        touched_cells.push_back(idx);
+    }
+    cell.agent=agent_id;
+    cell.prev=prev;
+}
+
+void PathTable::insertPath(int agent_id, const Path& path, bool verbose)
 {
 
     if (verbose) {
         std::cerr<<"insertPath for agent "<<agent_id<<" paths: ";
-        for (auto p : _path) {
+        for (auto p : path) {
             std::cerr<<p.location<<" ";
         }
         std::cerr<<std::endl;
     }
 
-    if (_path.empty())
+    if (path.empty())
         return;
     
-    int T = (int) _path.size();
-    if (window_size>0 && window_size+1<_path.size()) {
-        T = window_size+1;
-    }
-    Path path(_path.begin(), _path.begin() + T);
+    int T = min((int) path.size(), horizon());
 
-    for (int t = 0; t < (int)path.size(); t++)
+    for (int t = 0; t < T; t++)
     {
-        if (table[path[t].location].size() <= t)
-            table[path[t].location].resize(t + 1, NO_AGENT);
-        // assert(table[path[t].location][t] == NO_AGENT);
-        table[path[t].location][t] = agent_id;
+        // assert(getAgent(path[t].location,t) == NO_AGENT);
+        setCell(path[t].location, t, agent_id, t>0?path[t-1].location:-1);
     }
-    assert(goals[path.back().location] == MAX_TIMESTEP);
-    goals[path.back().location] = (int) path.size() - 1;
-    makespan = max(makespan, (int) path.size() - 1);
+    assert(goals[path[T-1].location] == MAX_TIMESTEP);
+    goals[path[T-1].location] = T - 1;
+    touched_goals.push_back(path[T-1].location);
+    makespan = max(makespan, T - 1);
 }
 
-void PathTable::deletePath(int agent_id, const Path& _path,bool verbose)
+void PathTable::deletePath(int agent_id, const Path& path,bool verbose)
 {
     if (verbose) {
         std::cerr<<"deletePath for agent "<<agent_id<<" paths: ";
-        for (auto p : _path) {
+        for (auto p : path) {
             std::cerr<<p.location<<" ";
         }
         std::cerr<<std::endl;
     }
 
-    if (_path.empty())
+    if (path.empty())
         return;
     
-    int T = (int) _path.size();
-    if (window_size>0 && window_size+1<_path.size()) {
-        T = window_size+1;
-    }
-    Path path(_path.begin(), _path.begin() + T);
+    int T = min((int) path.size(), horizon());
     
-    for (int t = 0; t < (int)path.size() ; t++)
+    for (int t = 0; t < T ; t++)
     {
-        assert(table[path[t].location].size() > t && table[path[t].location][t] == agent_id);
-        table[path[t].location][t] = NO_AGENT;
+        assert(getAgent(path[t].location,t) == agent_id);
+        table[t*map_size+path[t].location].agent = NO_AGENT;
     }
-    goals[path.back().location] = MAX_TIMESTEP;
+    goals[path[T-1].location] = MAX_TIMESTEP;
 
     // : when we use window size, we ignore this for now, maybe we can use a better data structure such as ordered_set/heap to maintain the makespan. 
     // if (makespan == (int) path.size() - 1) // re-compute makespan
@@ -89,24 +123,14 @@ void PathTable::insertPath(int agent_id, const Parallel::Path& _path, bool verbo
     if (_path.nodes.empty())
         return;
     
-    int T = (int) _path.nodes.size();
-    if (window_size>0 && window_size+1<_path.nodes.size()) {
-        T = window_size+1;
-    }
-
     auto & path=_path.nodes;
-
+    int T = min((int) path.size(), horizon());
 
     for (int t = 0; t < T; t++)
     {
-        if (table[path[t].location].size() <= t)
-            table[path[t].location].resize(t + 1, NO_AGENT);
-        // assert(table[path[t].location][t] == NO_AGENT);
-            
-        // cerr<<t<<","<<table[path[t].location][t]<<" ";
-        table[path[t].location][t] = agent_id;
+        // assert(getAgent(path[t].location,t) == NO_AGENT);
+        setCell(path[t].location, t, agent_id, t>0?path[t-1].location:-1);
     }
-    // cerr<<endl;
 
     // : check whether we need maintain goals and makespan in the life-long setting
     // assert(goals[path.back().location] == MAX_TIMESTEP);
@@ -127,32 +151,16 @@ void PathTable::deletePath(int agent_id, const Parallel::Path& _path,bool verbos
     if (_path.nodes.empty())
         return;
     
-    int T = (int) _path.nodes.size();
-    if (window_size>0 && window_size+1<_path.nodes.size()) {
-        T = window_size+1;
-    }
-
     auto & path=_path.nodes;
+    int T = min((int) path.size(), horizon());
     
     for (int t = 0; t < T ; t++)
     {
-        assert(table[path[t].location].size() > t && table[path[t].location][t] == agent_id);
-        table[path[t].location][t] = NO_AGENT;
+        assert(getAgent(path[t].location,t) == agent_id);
+        table[t*map_size+path[t].location].agent = NO_AGENT;
     }
     // : check whether we need maintain goals and makespan  in the life-long setting
     // goals[path.back().location] = MAX_TIMESTEP;
-
-    // : when we use window size, we ignore this for now, maybe we can use a better data structure such as ordered_set/heap to maintain the makespan. 
-    // if (makespan == (int) path.size() - 1) // re-compute makespan
-    // {
-    //     makespan = 0;
-    //     for (int time : goals)
-    //     {
-    //         if (time < MAX_TIMESTEP && time > makespan)
-    //             makespan = time;
-    //     }
-
-    // }
 }
 
 
@@ -163,10 +171,9 @@ bool PathTable::constrained(int from, int to, int to_time) const
 {
     if (!table.empty())
     {
-        if (table[to].size() > to_time && table[to][to_time] != NO_AGENT)
+        if (getAgent(to, to_time) != NO_AGENT)
             return true;  // vertex conflict with agent table[to][to_time]
-        else if (table[to].size() >= to_time && table[from].size() > to_time && !table[to].empty() &&
-                 table[to][to_time - 1] != NO_AGENT && table[from][to_time] == table[to][to_time - 1])
+        else if (getEdgeAgent(from, to, to_time) != NO_AGENT)
             return true;  // edge conflict with agent table[to][to_time - 1]
     }
     // if (!goals.empty())
@@ -181,31 +188,14 @@ bool PathTable::constrained(int from, int to, int to_time, std::vector<int> & ig
 {
     if (!table.empty())
     {
-        if (table[to].size() > to_time && table[to][to_time] != NO_AGENT) {
-            bool found=false;
-            for (int i=0;i<ignored_agents.size();++i) {
-                if (table[to][to_time]==ignored_agents[i]) {
-                    found=true;
-                    break;
-                }
-            }
-            if (!found) {
-                return true;  // vertex conflict with agent table[to][to_time]
-            }
+        int agent = getAgent(to, to_time);
+        if (agent != NO_AGENT && std::find(ignored_agents.begin(), ignored_agents.end(), agent) == ignored_agents.end()) {
+            return true;  // vertex conflict with agent table[to][to_time]
         }
-        
-        if (table[to].size() >= to_time && table[from].size() > to_time && !table[to].empty() &&
-                 table[to][to_time - 1] != NO_AGENT && table[from][to_time] == table[to][to_time - 1]) {
-            bool found=false;
-            for (int i=0;i<ignored_agents.size();++i) {
-                if (table[to][to_time-1]==ignored_agents[i]) {
-                    found=true;
-                    break;
-                }
-            }
-            if (!found) {
-                return true;  // edge conflict with agent table[to][to_time - 1]
-            }
+
+        agent = getEdgeAgent(from, to, to_time);
+        if (agent != NO_AGENT && std::find(ignored_agents.begin(), ignored_agents.end(), agent) == ignored_agents.end()) {
+            return true;  // edge conflict with agent table[to][to_time - 1]
         }
     }
 
@@ -222,49 +212,51 @@ void PathTable::getConflictingAgents(int agent_id, set<int>& conflicting_agents,
 {
     if (table.empty())
         return;
-    if (table[to].size() > to_time && table[to][to_time] != NO_AGENT)
-        conflicting_agents.insert(table[to][to_time]); // vertex conflict
-    if (table[to].size() >= to_time && table[from].size() > to_time &&
-        table[to][to_time - 1] != NO_AGENT && table[from][to_time] == table[to][to_time - 1])
-        conflicting_agents.insert(table[from][to_time]); // edge conflict
+    int agent = getAgent(to, to_time);
+    if (agent != NO_AGENT)
+        conflicting_agents.insert(agent); // vertex conflict
+    agent = getEdgeAgent(from, to, to_time);
+    if (agent != NO_AGENT)
+        conflicting_agents.insert(agent); // edge conflict
     // TODO: collect target conflicts as well.
 }
 
 void PathTable::get_agents(set<int>& conflicting_agents, int loc) const
 {
-    if (loc < 0)
+    if (loc < 0 || table.empty())
         return;
-    for (auto agent : table[loc])
+    for (int t = 0; t < horizon(); t++)
     {
+        int agent = getAgent(loc, t);
         if (agent >= 0)
             conflicting_agents.insert(agent);
     }
 }
 
-void PathTable::get_agents(set<int>& conflicting_agents, int neighbor_size, int loc) const
+void PathTable::get_agents(set<int>& conflicting_agents, int neighbor_size, int loc, Philox & MT) const
 {
-    if (loc < 0 || table[loc].empty())
+    if (loc < 0 || table.empty())
         return;
-    int t_max = (int) table[loc].size() - 1;
-    while (table[loc][t_max] == NO_AGENT && t_max > 0)
+    int t_max = horizon() - 1;
+    while (getAgent(loc, t_max) == NO_AGENT && t_max > 0)
         t_max--;
     if (t_max == 0)
         return;
-    int t0 = rand() % t_max;
-    if (table[loc][t0] != NO_AGENT)
-        conflicting_agents.insert(table[loc][t0]);
+    int t0 = MT() % t_max;
+    if (getAgent(loc, t0) != NO_AGENT)
+        conflicting_agents.insert(getAgent(loc, t0));
     int delta = 1;
     while (t0 - delta >= 0 || t0 + delta <= t_max)
     {
-        if (t0 - delta >= 0 && table[loc][t0 - delta] != NO_AGENT)
+        if (t0 - delta >= 0 && getAgent(loc, t0 - delta) != NO_AGENT)
         {
-            conflicting_agents.insert(table[loc][t0 - delta]);
+            conflicting_agents.insert(getAgent(loc, t0 - delta));
             if((int) conflicting_agents.size() == neighbor_size)
                 return;
         }
-        if (t0 + delta <= t_max && table[loc][t0 + delta] != NO_AGENT)
+        if (t0 + delta <= t_max && getAgent(loc, t0 + delta) != NO_AGENT)
         {
-            conflicting_agents.insert(table[loc][t0 + delta]);
+            conflicting_agents.insert(getAgent(loc, t0 + delta));
             if((int) conflicting_agents.size() == neighbor_size)
                 return;
         }
@@ -275,10 +267,10 @@ void PathTable::get_agents(set<int>& conflicting_agents, int neighbor_size, int
 // get the holding time after the earliest_timestep for a location
 int PathTable::getHoldingTime(int location, int earliest_timestep = 0) const
 {
-    if (table.empty() or (int) table[location].size() <= earliest_timestep)
+    if (table.empty() or horizon() <= earliest_timestep)
         return earliest_timestep;
-    int rst = (int) table[location].size();
-    while (rst > earliest_timestep and table[location][rst - 1] == NO_AGENT)
+    int rst = horizon();
+    while (rst > earliest_timestep and getAgent(location, rst - 1) == NO_AGENT)
         rst--;
     return rst;
 }
@@ -200,23 +200,23 @@ void ReservationTable::updateSIT(int location)
 
     // : currently, we only deal with the window size in this case.
     // path table
-    if (constraint_table.path_table_for_CT != nullptr and !constraint_table.path_table_for_CT->table.empty())
+    if (constraint_table.path_table_for_CT != nullptr and !constraint_table.path_table_for_CT->empty())
     {
+        auto & path_table=*constraint_table.path_table_for_CT;
+        int T=min(path_table.horizon(), constraint_table.window_size_for_CT+1);
         if (location < constraint_table.map_size) // vertex conflict
         {
-            int T=min((int)constraint_table.path_table_for_CT->table[location].size(), constraint_table.window_size_for_CT+1);
-
             for (int t = 0; t < T; t++)
             {
-                if (constraint_table.path_table_for_CT->table[location][t] != NO_AGENT)
+                if (path_table.getAgent(location, t) != NO_AGENT)
                 {
                     insert2SIT(location, t, t+1);
                 }
             }
             
             T = min(MAX_TIMESTEP, constraint_table.window_size_for_CT+1);
-            if (constraint_table.path_table_for_CT->goals[location] < T) // target conflict
-                insert2SIT(location, constraint_table.path_table_for_CT->goals[location], T + 1);
+            if (path_table.goals[location] < T) // target conflict
+                insert2SIT(location, path_table.goals[location], T + 1);
         }
         else // edge conflict
         {
@@ -224,14 +224,9 @@ void ReservationTable::updateSIT(int location)
             auto to = location % constraint_table.map_size;
             if (from != to)
             {
-                int t_max = (int) min(constraint_table.path_table_for_CT->table[from].size(),
-                                      constraint_table.path_table_for_CT->table[to].size() + 1);
-                t_max = min(t_max, constraint_table.window_size_for_CT+1);
-                for (int t = 1; t < t_max; t++)
+                for (int t = 1; t < T; t++)
                 {
-                    if (constraint_table.path_table_for_CT->table[to][t - 1] != NO_AGENT and
-                        constraint_table.path_table_for_CT->table[to][t - 1] ==
-                        constraint_table.path_table_for_CT->table[from][t])
+                    if (path_table.getEdgeAgent(from, to, t) != NO_AGENT)
                     {
                         insert2SIT(location, t, t+1);
                     }
@@ -182,27 +182,27 @@ float LaCAM2Solver::eval_solution(const Instance & instance, const Solution & so
         // : should we consider the case of arrival here?
         bool arrived=false;
         for (int i=0;i<solution.size()-1;++i) {
-            if (solution[i].arrivals[aid]) {
+            if (solution[i].arrived(aid)) {
                 arrived=true;
                 break;
             }
-            int loc=solution[i].locs[aid]->index;
+            int loc=solution[i].locs[aid];
             int orient=solution[i].orients[aid];
-            int next_loc=solution[i+1].locs[aid]->index;
+            int next_loc=solution[i+1].locs[aid];
             int next_orient=solution[i+1].orients[aid];
             cost+=get_action_cost(loc,orient,next_loc,next_orient);
         }
         if (!arrived){
-            int loc=solution.back().locs[aid]->index;
+            int loc=solution.back().locs[aid];
             int orient=solution.back().orients[aid];
-            cost += HT->get(loc,orient,instance.goals.locs[aid]->index);
+            cost += HT->get(loc,orient,instance.goals.locs[aid]);
         }
     }
 
     return cost;
 }
 
-void LaCAM2Solver::plan(const SharedEnvironment & env, std::vector<Path> * precomputed_paths, std::vector<::State> * starts, std::vector<::State> * goals){
+void LaCAM2Solver::plan(const SharedEnvironment & env, std::vector<Path> * precomputed_paths, std::vector<::State> * starts, std::vector<::State> * goals, double time_limit_ms){
     ONLYDEV(g_timer.record_p("lacam2_plan_pre_s");)
     // std::cerr<<"random :"<<get_random_int(MT,0,100)<<std::endl;
 
@@ -228,7 +228,6 @@ void LaCAM2Solver::plan(const SharedEnvironment & env, std::vector<Path> * preco
 
     if (need_replan) {
         const int verbose = 10;
-        const int time_limit_sec = 2;
         ONLYDEV(g_timer.record_p("lacam_build_instance_s");)
         auto instance = build_instance(env, precomputed_paths);
         if (starts!=nullptr) {
@@ -242,7 +241,7 @@ void LaCAM2Solver::plan(const SharedEnvironment & env, std::vector<Path> * preco
         if (precomputed_paths!=nullptr) {
             // we need to check the initial states are the same.
             for (int i=0;i<env.num_of_agents;++i) {
-                if ((*precomputed_paths)[i].size()==0 || (*precomputed_paths)[i][0].location!=instance.starts.locs[i]->index) {
+                if ((*precomputed_paths)[i].size()==0 || (*precomputed_paths)[i][0].location!=instance.starts.locs[i]) {
                     cerr<<"agent "<<i<<" has zero-length precomputed paths or initial states are not the same!"<<endl;
                     cerr<<"size: "<<(*precomputed_paths)[i].size()<<endl;
                     cerr<<"states: "<<(*precomputed_paths)[i][0]<<" vs "<<instance.starts.locs[i]<<endl;
@@ -252,10 +251,34 @@ void LaCAM2Solver::plan(const SharedEnvironment & env, std::vector<Path> * preco
         }
 
         ONLYDEV(g_timer.record_d("lacam_build_instance_s","lacam_build_instance");)
-        const auto deadline = Deadline(time_limit_sec * 1000);
+        // leave a margin of the budget for building and copying the paths.
+        const auto deadline = Deadline(time_limit_ms * read_param_json<double>(config,"time_limit_ratio",0.9));
+        bool anytime=read_param_json<bool>(config,"anytime",false);
+        int pibt_tiles=read_param_json<int>(config,"pibt_tiles",0);
+        int pibt_slices=read_param_json<int>(config,"pibt_slices",8);
         bool use_swap=false; // TODO: we need try use_swap
         bool use_orient_in_heuristic=read_param_json<bool>(config,"use_orient_in_heuristic");
 
+        // agents whose goal is unchanged (elapsed>0) and who are where the previous plan expects them
+        // keep the rest of it as a hint, the others are ordered after them.
+        vector<::Path> warm_paths;
+        if (warm_start && precomputed_paths==nullptr && starts==nullptr && !prev_paths.empty()) {
+            ONLYDEV(g_timer.record_p("lacam_warm_start_s");)
+            warm_paths.resize(env.num_of_agents);
+            int n_warm=0;
+            for (int i=0;i<env.num_of_agents;++i) {
+                auto & prev_path=prev_paths[i];
+                if ((*agent_infos)[i].elapsed<=0 || prev_path.size()<=prev_timestep+1) continue;
+                auto & state=prev_path[prev_timestep];
+                if (state.location!=env.curr_states[i].location || state.orientation!=env.curr_states[i].orientation) continue;
+                warm_paths[i].assign(prev_path.begin()+prev_timestep,prev_path.end());
+                ++n_warm;
+            }
+            instance.precomputed_paths=&warm_paths;
+            DEV_DEBUG("lacam2 warm start: {} of {} agents follow the previous plan", n_warm, env.num_of_agents);
+            ONLYDEV(g_timer.record_d("lacam_warm_start_s","lacam_warm_start");)
+        }
+
         vector<::Path> precomputed_paths;
         if (read_param_json<int>(config["SUO"],"iterations")>0) {
             ONLYDEV(g_timer.record_p("suo_init_s");)
@@ -295,6 +318,14 @@ void LaCAM2Solver::plan(const SharedEnvironment & env, std::vector<Path> * preco
             }
             // we need to change precomputed_paths to suo_paths. because the former one means hard constraints to follow
             // but the latter one is just a suggesion.
+            // with a warm start, agents that still follow the previous plan keep it and the others take the suo path.
+            if (!warm_paths.empty()) {
+                for (int i=0;i<env.num_of_agents;++i) {
+                    if (!warm_paths[i].empty()) {
+                        precomputed_paths[i]=std::move(warm_paths[i]);
+                    }
+                }
+            }
             instance.precomputed_paths=&precomputed_paths;
             ONLYDEV(g_timer.record_d("copy_suo_paths_s","copy_suo_paths");)
         }
@@ -303,42 +334,119 @@ void LaCAM2Solver::plan(const SharedEnvironment & env, std::vector<Path> * preco
         Solution best_solution;
         ONLYDEV(g_timer.record_d("lacam2_plan_pre_s","lacam2_plan_pre");)
 
-        // #pragma omp parallel for
-        // for (int i=1;i<2;++i) {
-            
-            int order_strategy=1;
-            string _order_strategy=read_param_json<string>(config,"order_strategy");
-            if (_order_strategy=="early_time") {
-                order_strategy=1;
-            } else if (_order_strategy=="short_dist") {
-                order_strategy=0;
-            } else {
-                cout<<"unknown order strategy: "<<_order_strategy<<endl;
-                exit(-1);
+        int order_strategy=1;
+        string _order_strategy=read_param_json<string>(config,"order_strategy");
+        if (_order_strategy=="early_time") {
+            order_strategy=1;
+        } else if (_order_strategy=="short_dist") {
+            order_strategy=0;
+        } else {
+            cout<<"unknown order strategy: "<<_order_strategy<<endl;
+            exit(-1);
+        }
+
+        // portfolio: member 0 is the configured planner, the others flip the order strategy (k&1), use_swap (k&2)
+        // and disable_agent_goals (k&4), and use their own seeds. the best solution by eval_solution is kept,
+        // the lowest k on ties.
+        int portfolio_size=std::max(1,read_param_json<int>(config,"portfolio_size",1));
+
+        while (portfolio_arenas.size()<portfolio_size-1) {
+            portfolio_arenas.emplace_back(new Arena());
+        }
+        std::vector<std::mt19937> portfolio_MTs;
+        for (int k=1;k<portfolio_size;++k) {
+            portfolio_MTs.emplace_back((*MT)());
+        }
+
+        // the best cost of the portfolio so far. every step of an agent before its arrival costs at least
+        // min_weight in eval_solution, and the heuristics bound the rest, so members stop once they cannot beat it.
+        std::atomic<float> portfolio_best_cost(FLT_MAX);
+        auto publish_cost=[&](float cost) {
+            float curr=portfolio_best_cost.load();
+            while (cost<curr && !portfolio_best_cost.compare_exchange_weak(curr,cost));
+        };
+        float min_weight=FLT_MAX;
+        if (portfolio_size>1) {
+            for (auto w: *(HT->map_weights)) {
+                min_weight=std::min(min_weight,w);
+            }
+            min_weight=std::max(min_weight,0.0f);
+        }
+
+        int best_k=-1;
+        ONLYDEV(g_timer.record_p("lacam_solve_s");)
+        #pragma omp parallel for num_threads(portfolio_size) schedule(static,1) if(portfolio_size>1)
+        for (int k=0;k<portfolio_size;++k) {
+            // a planner may change the goals of disabled agents, so every member has its own instance.
+            Instance member_instance=instance;
+            int member_order_strategy=(k&1)?1-order_strategy:order_strategy;
+            bool member_use_swap=(k&2)?!use_swap:use_swap;
+            bool member_disable_agent_goals=(k&4)?!disable_agent_goals:disable_agent_goals;
+
+            // the heuristics of the member bound eval_solution if it plans to the evaluated goals,
+            // apart from the disabled agents it parks, whose heuristics are 0.
+            bool bound_by_h=true;
+            if (member_disable_agent_goals!=disable_agent_goals) {
+                for (int i=0;i<env.num_of_agents;++i) {
+                    if (!(*agent_infos)[i].disabled)
+                        continue;
+                    if (member_disable_agent_goals) {
+                        member_instance.goals.set(i,member_instance.starts.locs[i],-1);
+                    } else {
+                        int goal_location=goals!=nullptr?(*goals)[i].location:env.goal_locations[i][0].first;
+                        member_instance.goals.set(i,goal_location,-1);
+                        bound_by_h&=goal_location==instance.goals.locs[i];
+                    }
+                }
             }
 
-            ONLYDEV(g_timer.record_p("lacam_build_planner_s");)
-            auto planner = Planner(&instance,HT,map_weights,&deadline,MT,0,LaCAM2::OBJ_SUM_OF_LOSS,0.0F,
-                use_swap,
+            auto planner = Planner(&member_instance,HT,map_weights,&deadline,
+                k==0?MT:&portfolio_MTs[k-1],
+                0,LaCAM2::OBJ_SUM_OF_LOSS,0.0F,
+                member_use_swap,
                 use_orient_in_heuristic,
                 use_external_executor,
-                disable_agent_goals
+                member_disable_agent_goals,
+                k==0?&arena:portfolio_arenas[k-1].get()
             );
-            ONLYDEV(g_timer.record_d("lacam_build_planner_s","lacam_build_planner");)
+            planner.anytime=anytime;
+            planner.pibt_tiles=pibt_tiles;
+            planner.pibt_slices=pibt_slices;
+            if (portfolio_size>1) {
+                planner.cost_bound=&portfolio_best_cost;
+                planner.bound_g_weight=min_weight;
+                planner.bound_h_weight=bound_by_h?1.0f:0.0f;
+                planner.on_solution=[&,k](const Solution & solution, float f) {
+                    float cost=eval_solution(instance,solution);
+                    DEV_DEBUG("lacam2 planner {}: solution of f {}, cost {}", k, f, cost);
+                    publish_cost(cost);
+                };
+            }
             auto additional_info = std::string("");
-            ONLYDEV(g_timer.record_p("lacam_solve_s");)
-            auto solution=planner.solve(additional_info,order_strategy);
-            ONLYDEV(g_timer.record_d("lacam_solve_s","lacam_solve");)
+            auto solution=planner.solve(additional_info,member_order_strategy);
+            DEV_DEBUG("lacam2 planner {}: {} get_new_config calls in {:.3f} ms, {} nodes dropped by the bound", k, planner.get_new_config_cnt, planner.get_new_config_ms, planner.bound_pruned_cnt);
+            if (solution.empty()) continue;
+
             auto cost=eval_solution(instance,solution);
-            // #pragma omp critical
+            publish_cost(cost);
+            #pragma omp critical
             {
-                if (cost<best_cost) {
+                if (cost<best_cost || (cost==best_cost && k<best_k)) {
                     best_cost=cost;
-                    best_solution=solution;
+                    best_k=k;
+                    best_solution=std::move(solution);
                 }
-                // std::cerr<<i<<precomputed_paths[i]<<endl;
             }
-        // }
+        }
+        DEV_DEBUG("lacam2 portfolio: planner {} wins with cost {}", best_k, best_cost);
+        ONLYDEV(g_timer.record_d("lacam_solve_s","lacam_solve");)
+
+        // no planner found a solution in time: all agents wait until the end of the window,
+        // so that every path still has the next state and the lns still gets paths as long as its window.
+        if (best_solution.empty()) {
+            DEV_WARN("lacam2 found no solution, all agents wait");
+            best_solution.assign(std::max(instance.planning_window,1)+1,instance.starts);
+        }
 
         // std::cout<<"old:"<<std::endl;
         // for (int i=0;i<env.num_of_agents;++i) {
@@ -359,7 +467,7 @@ void LaCAM2Solver::plan(const SharedEnvironment & env, std::vector<Path> * preco
                 // }
                 // cerr<<endl;
                 for (int j=0;j<best_solution.size();++j) {
-                    paths[i].emplace_back(best_solution[j].locs[i]->index,j,best_solution[j].orients[i]);
+                    paths[i].emplace_back(best_solution[j].locs[i],j,best_solution[j].orients[i]);
                 }
                 if (paths[i].size()==1) {
                     paths[i].emplace_back(paths[i].back().location,paths[i].size(),paths[i].back().orientation);
@@ -494,67 +602,17 @@ void LaCAM2Solver::plan(const SharedEnvironment & env, std::vector<Path> * preco
 
 void LaCAM2Solver::solution_convert(const SharedEnvironment & env, Solution & solution, std::vector<Path> & _paths) {
 
-    int num_steps=0;
-
     int N=_paths.size();
 
     int planning_window=read_param_json<int>(config,"planning_window");
 
     auto & curr_config=solution[0];
 
-    std::vector<::State> curr_states;
     for (int aid=0;aid<N;++aid) {
-        curr_states.emplace_back(curr_config.locs[aid]->index,0,curr_config.orients[aid]);
-        _paths[aid].push_back(curr_states[aid]);
+        _paths[aid].emplace_back(curr_config.locs[aid],0,curr_config.orients[aid]);
     }
 
-    // std::cout<<solution.size()<<std::endl;
-
-    for (int i=1;i<solution.size();++i) {
-        auto & next_config=solution[i];
-        while (true) {
-            std::vector<::State> planned_next_states;
-            std::vector<::State> next_states;
-        
-            planned_next_states.reserve(N);
-            next_states.reserve(N);
-
-            for (int i=0;i<N;++i){
-                planned_next_states.emplace_back(next_config.locs[i]->index,-1,-1);
-                next_states.emplace_back(-1,-1,-1);
-            }
-
-            executor.execute(&curr_states,&planned_next_states,&next_states);
-
-            curr_states=next_states;
-            ++num_steps;
-
-            for (int aid=0;aid<N;++aid) {
-                _paths[aid].push_back(next_states[aid]);
-            }
-
-            if (num_steps>=planning_window) {
-                break;
-            }
-
-            // check if arrived
-            bool arrived=true;
-            for (int aid=0;aid<N;++aid) {
-                if (planned_next_states[aid].location!=next_states[aid].location) {
-                    arrived=false;
-                    break;
-                }
-            }
-
-            if (arrived) {
-                break;
-            }
-        }
-
-        if (num_steps>=planning_window) {
-            break;
-        }
-    }
+    executor.execute_plan(solution,planning_window,_paths);
 }
 
 void LaCAM2Solver::get_step_actions(const SharedEnvironment & env, vector<Action> & actions) {
@@ -660,7 +718,7 @@ void LaCAM2Solver::get_step_actions(const SharedEnvironment & env, vector<Action
 
     // bool all_arrived=true;
     // for (int i=0;i<env.num_of_agents;++i) {
-    //     if (paths[i][timestep].location!=next_config.locs[i]->index) {
+    //     if (paths[i][timestep].location!=next_config.locs[i]) {
     //         // arrive goal locations
     //         all_arrived=false;
     //         break;
@@ -689,6 +747,11 @@ void LaCAM2Solver::get_step_actions(const SharedEnvironment & env, vector<Action
     // }
 
     if (need_replan) {
+        if (warm_start) {
+            prev_paths.swap(paths);
+            prev_timestep=timestep;
+            paths.resize(env.num_of_agents);
+        }
         for (int i=0;i<env.num_of_agents;++i) {
             // paths[i].resize(timestep+1);
             paths[i].clear();
@@ -0,0 +1,57 @@
+#include "LaCAM2/arena.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+
+namespace LaCAM2 {
+
+Arena::~Arena()
+{
+  reset();
+  for (auto& chunk : chunks) std::free(chunk.data);
+}
+
+void* Arena::allocate(size_t size, size_t align)
+{
+  while (curr < chunks.size()) {
+    auto& chunk = chunks[curr];
+    size_t start = (offset + align - 1) / align * align;
+    if (start + size <= chunk.size) {
+      offset = start + size;
+      return chunk.data + start;
+    }
+    ++curr;
+    offset = 0;
+  }
+
+  // malloc is aligned for any fundamental type.
+  size_t size_needed = std::max(chunk_size, size + align);
+  char* data = (char*)std::malloc(size_needed);
+  if (data == nullptr) {
+    std::cerr << "arena failed to allocate " << size_needed << " bytes" << std::endl;
+    exit(-1);
+  }
+  chunks.push_back({data, size_needed});
+  curr = chunks.size() - 1;
+  offset = size;
+  return data;
+}
+
+void Arena::reset()
+{
+  for (auto itr = finalizers.rbegin(); itr != finalizers.rend(); ++itr) {
+    itr->second(itr->first);
+  }
+  finalizers.clear();
+  curr = 0;
+  offset = 0;
+}
+
+size_t Arena::capacity() const
+{
+  size_t total = 0;
+  for (auto& chunk : chunks) total += chunk.size;
+  return total;
+}
+
+}  // namespace LaCAM2
@@ -21,10 +21,8 @@ Instance::Instance(
   // for (auto k : goal_indexes) goals.push_back(G.U[k]);
 
   for (int i=0;i<N;++i) {
-    starts.locs[i]=G.U[start_indexes[i].first];
-    starts.orients[i]=start_indexes[i].second;
-    goals.locs[i]=G.U[goal_indexes[i].first];
-    goals.orients[i]=goal_indexes[i].second;
+    starts.set(i,start_indexes[i].first,start_indexes[i].second);
+    goals.set(i,goal_indexes[i].first,goal_indexes[i].second);
   }
 
 }
@@ -34,10 +32,8 @@ void Instance::set_starts_and_goals(std::vector<::State> * starts_ptr, std::vect
   auto & goals=*goals_ptr;
 
   for (int i=0;i<N;++i) {
-    this->starts.locs[i]=G.U[starts[i].location];
-    this->starts.orients[i]=starts[i].orientation;
-    this->goals.locs[i]=G.U[goals[i].location];
-    this->goals.orients[i]=goals[i].orientation;
+    this->starts.set(i,starts[i].location,starts[i].orientation);
+    this->goals.set(i,goals[i].location,goals[i].orientation);
   }
 }
 
@@ -128,7 +124,7 @@ std::ostream& operator<<(std::ostream& os, const Solution& solution)
     os << std::setw(5) << i << ":";
     for (size_t k = 0; k < solution[i].size(); ++k) {
       if (k > 0) os << "->";
-      os << "(" << std::setw(5) << solution[i].locs[k]->index <<"," << solution[i].orients[k] << ")"; 
+      os << "(" << std::setw(5) << solution[i].locs[k] <<"," << (int)solution[i].orients[k] << ")"; 
     }
     os << std::endl;
   }
@@ -31,32 +31,45 @@ int get_neighbor_orientation(const Graph & G, int loc1, int loc2, int default_va
 
 }
 
-LNode::LNode(LNode* parent, uint i, const std::tuple<Vertex*,int > & t)
-    : who(), where(), depth(parent == nullptr ? 0 : parent->depth + 1)
+LNode::LNode(LNode* _parent, uint i, const std::tuple<Vertex*,int > & t)
+    : parent(_parent), who(i), where(std::get<0>(t)), orient(std::get<1>(t)), depth(_parent == nullptr ? 0 : _parent->depth + 1)
 {
-  if (parent != nullptr) {
-    who = parent->who;
-    who.push_back(i);
-    where = parent->where;
-    where.push_back(t);
+}
+
+// the order of agents in a high-level node: not disabled, not arrived and precomputed first,
+// then by elapse and h depending on the strategy. the id makes it a total order, so the result
+// doesn't depend on how we sort.
+bool agent_score_less(const AgentScore & s1, const AgentScore & s2, int order_strategy)
+{
+  if (s1.disabled!=s2.disabled) return s1.disabled<s2.disabled;
+  if (s1.arrived!=s2.arrived) return s1.arrived<s2.arrived;
+  if (s1.precomputed!=s2.precomputed) return s1.precomputed>s2.precomputed;
+  if (order_strategy==0) {
+    if (s1.h!=s2.h) return s1.h<s2.h;
+    if (s1.elapse!=s2.elapse) return s1.elapse>s2.elapse;
+  } else if (order_strategy==1) {
+    if (s1.elapse!=s2.elapse) return s1.elapse>s2.elapse;
+    if (s1.h!=s2.h) return s1.h<s2.h;
   }
+  if (s1.tie_breaker!=s2.tie_breaker) return s1.tie_breaker>s2.tie_breaker;
+  return s1.id<s2.id;
 }
 
-uint HNode::HNODE_CNT = 0;
+std::atomic<uint> HNode::HNODE_CNT(0);
 
 // for high-level
 HNode::HNode(const Config& _C, const std::shared_ptr<HeuristicTable> & HT, Instance * ins, HNode* _parent, float _g,
-             float _h, const uint _d, int _order_strategy, bool disable_agent_goals)
+             float _h, const uint _d, int _order_strategy, bool disable_agent_goals, Arena * arena)
     : C(_C),
       parent(_parent),
-      neighbor(),
+      neighbor(std::less<HNode*>(), ArenaAllocator<HNode*>(arena)),
       g(_g),
       h(_h),
       d(_d),
       f(g + h),
-      priorities(C.size()),
-      order(C.size(), 0),
-      search_tree(std::queue<LNode*>()),
+      order(C.size(), 0, ArenaAllocator<uint>(arena)),
+      scores(C.size(), AgentScore(), ArenaAllocator<AgentScore>(arena)),
+      search_tree(std::deque<LNode*, ArenaAllocator<LNode*> >(ArenaAllocator<LNode*>(arena))),
       order_strategy(_order_strategy)
 {
   ++HNODE_CNT;
@@ -68,38 +81,59 @@ HNode::HNode(const Config& _C, const std::shared_ptr<HeuristicTable> & HT, Insta
 
   for (int aid=0;aid<N;++aid) {
     if ((disable_agent_goals && ins->agent_infos[aid].disabled)) {
-      ins->goals.locs[aid]=C.locs[aid];
+      ins->goals.set(aid,C.locs[aid],ins->goals.orients[aid]);
     }
   }
 
-  std::vector<std::tuple<bool,bool,bool,float,float,float,int> > scores;
+  // look up the heuristics of all agents in one batch.
+  // the buffers are only used during construction, so they are reused between nodes.
+  static thread_local std::vector<int> locs, orients, goals;
+  static thread_local std::vector<float> hs;
+  locs.resize(N);
+  orients.resize(N);
+  goals.resize(N);
+  hs.resize(N);
+  for (int i=0;i<N;++i) {
+    locs[i]=C.locs[i];
+    orients[i]=C.orients[i];
+    goals[i]=ins->goals.locs[i];
+  }
+  HT->get_many(locs.data(),orients.data(),goals.data(),hs.data(),(int)N);
+
   for (int i=0;i<N;++i) {
     const AgentInfo & a=ins->agent_infos[i];
-    bool disabled=a.disabled;
-    bool arrived=C.arrivals[i];
-    bool precomputed = ins->precomputed_paths!=nullptr && (*(ins->precomputed_paths))[i].size()>(d+1); // not not precomputed first
-    float h=HT->get(C.locs[i]->index,C.orients[i],ins->goals.locs[i]->index); // smaller h first
-    float elapse=a.elapsed; // larger elapse first
-    float tie_breaker=a.tie_breaker; 
-    scores.emplace_back(disabled,arrived,precomputed,elapse,h,tie_breaker,i);
+    auto & score=scores[i];
+    score.disabled=a.disabled;
+    score.arrived=C.arrived(i);
+    score.precomputed=ins->precomputed_paths!=nullptr && (*(ins->precomputed_paths))[i].size()>(d+1);
+    score.elapse=a.elapsed;
+    score.h=hs[i];
+    score.tie_breaker=a.tie_breaker;
+    score.id=i;
   }
 
-  std::sort(scores.begin(),scores.end(),[&](std::tuple<bool,bool,bool,float,float,float,int> &score1, std::tuple<bool,bool,bool,float,float,float,int> &score2) {
-    if (std::get<0>(score1)!=std::get<0>(score2)) return std::get<0>(score1)<std::get<0>(score2);
-    if (std::get<1>(score1)!=std::get<1>(score2)) return std::get<1>(score1)<std::get<1>(score2);
-    if (std::get<2>(score1)!=std::get<2>(score2)) return std::get<2>(score1)>std::get<2>(score2);
-    if (order_strategy==0) {
-      if (std::get<4>(score1)!=std::get<4>(score2)) return std::get<4>(score1)<std::get<4>(score2);
-      if (std::get<3>(score1)!=std::get<3>(score2)) return std::get<3>(score1)>std::get<3>(score2);
-    } else if (order_strategy==1) {
-      if (std::get<3>(score1)!=std::get<3>(score2)) return std::get<3>(score1)>std::get<3>(score2);
-      if (std::get<4>(score1)!=std::get<4>(score2)) return std::get<4>(score1)<std::get<4>(score2);
-    }
-    return std::get<5>(score1)>std::get<5>(score2);
-  });
+  auto less=[&](uint i, uint j) {
+    return agent_score_less(scores[i],scores[j],order_strategy);
+  };
 
-  for (int i=0;i<N;++i) {
-    order[i]=std::get<6>(scores[i]);
+  if (parent==nullptr) {
+    std::iota(order.begin(),order.end(),0);
+    std::sort(order.begin(),order.end(),less);
+  } else {
+    // agents whose scores did not change keep their relative order from the parent,
+    // so we only sort the changed ones and merge them in.
+    static thread_local std::vector<uint> kept, changed;
+    kept.clear();
+    changed.clear();
+    for (auto aid: parent->order) {
+      if (scores[aid]==parent->scores[aid]) {
+        kept.push_back(aid);
+      } else {
+        changed.push_back(aid);
+      }
+    }
+    std::sort(changed.begin(),changed.end(),less);
+    std::merge(kept.begin(),kept.end(),changed.begin(),changed.end(),order.begin(),less);
   }
 
 
@@ -115,8 +149,8 @@ HNode::HNode(const Config& _C, const std::shared_ptr<HeuristicTable> & HT, Insta
   //   //   disabled[aid]=true;
   //   // }
 
-  //   // int x=ins->goals.locs[aid]->index%ins->G.width;
-  //   // int y=ins->goals.locs[aid]->index/ins->G.width;
+  //   // int x=ins->goals.locs[aid]%ins->G.width;
+  //   // int y=ins->goals.locs[aid]/ins->G.width;
   //   // if (x>=29 && y>=29) {
   //   //   ins->goals.locs[aid]=C.locs[aid];
   //   //   disabled[aid]=true;
@@ -142,11 +176,11 @@ HNode::HNode(const Config& _C, const std::shared_ptr<HeuristicTable> & HT, Insta
   //         if (precomputed_a != precomputed_b) return (int)precomputed_a>(int)precomputed_b;
   //       }
 
-  //       // float h1=HT->get(C.locs[i]->index,ins->goals.locs[i]->index);
-  //       // float h2=HT->get(C.locs[j]->index,ins->goals.locs[j]->index);
+  //       // float h1=HT->get(C.locs[i],ins->goals.locs[i]);
+  //       // float h2=HT->get(C.locs[j],ins->goals.locs[j]);
 
-  //       float h1=HT->get(C.locs[i]->index,C.orients[i],ins->goals.locs[i]->index);
-  //       float h2=HT->get(C.locs[j]->index,C.orients[j],ins->goals.locs[j]->index);
+  //       float h1=HT->get(C.locs[i],C.orients[i],ins->goals.locs[i]);
+  //       float h2=HT->get(C.locs[j],C.orients[j],ins->goals.locs[j]);
 
 
   //       if (order_strategy==0) {
@@ -164,7 +198,7 @@ HNode::HNode(const Config& _C, const std::shared_ptr<HeuristicTable> & HT, Insta
 
   // });
 
-  search_tree.push(new LNode());
+  search_tree.push(arena->create<LNode>());
 
   // if (ins->precomputed_paths!=nullptr) {
   //   // low-level tree
@@ -187,17 +221,53 @@ HNode::HNode(const Config& _C, const std::shared_ptr<HeuristicTable> & HT, Insta
   // }
 }
 
-HNode::~HNode()
+ExploredTable::ExploredTable(bool by_depth, size_t capacity) : by_depth(by_depth)
+{
+  size_t cap = 1;
+  while (cap < capacity) cap <<= 1;
+  slots.resize(cap, {0, nullptr});
+}
+
+HNode* ExploredTable::find(const Config& C, int d) const
+{
+  const uint64_t h = key(C, d);
+  const size_t mask = slots.size() - 1;
+  for (size_t k = h & mask;; k = (k + 1) & mask) {
+    auto & slot = slots[k];
+    if (slot.second == nullptr) return nullptr;
+    if (slot.first == h && (!by_depth || slot.second->d == d) && slot.second->C == C) return slot.second;
+  }
+}
+
+void ExploredTable::insert(HNode* H)
+{
+  // keep the load factor below 1/2 so that probe sequences stay short.
+  if ((num + 1) * 2 > slots.size()) grow();
+  const uint64_t h = key(H->C, H->d);
+  const size_t mask = slots.size() - 1;
+  size_t k = h & mask;
+  while (slots[k].second != nullptr) k = (k + 1) & mask;
+  slots[k] = {h, H};
+  ++num;
+}
+
+void ExploredTable::grow()
 {
-  while (!search_tree.empty()) {
-    delete search_tree.front();
-    search_tree.pop();
+  std::vector<std::pair<uint64_t, HNode*> > old(slots.size() * 2, {0, nullptr});
+  old.swap(slots);
+  const size_t mask = slots.size() - 1;
+  for (auto & slot : old) {
+    if (slot.second == nullptr) continue;
+    size_t k = slot.first & mask;
+    while (slots[k].second != nullptr) k = (k + 1) & mask;
+    slots[k] = slot;
   }
 }
 
 Planner::Planner(Instance* _ins, const std::shared_ptr<HeuristicTable> & HT, const std::shared_ptr<std::vector<float> > & map_weights, const Deadline* _deadline,
                  std::mt19937* _MT, const int _verbose,
-                 const Objective _objective, const float _restart_rate, bool use_swap, bool use_orient_in_heuristic, bool use_external_executor, bool disable_agent_goals)
+                 const Objective _objective, const float _restart_rate, bool use_swap, bool use_orient_in_heuristic, bool use_external_executor, bool disable_agent_goals,
+                 Arena * arena)
     : ins(_ins),
       deadline(_deadline),
       MT(_MT),
@@ -212,13 +282,15 @@ Planner::Planner(Instance* _ins, const std::shared_ptr<HeuristicTable> & HT, con
       C_next(N),
       tie_breakers(V_size, 0),
       A(N, nullptr),
-      occupied_now(V_size, nullptr),
-      occupied_next(V_size, nullptr),
+      occupied_now(V_size),
+      occupied_next(V_size),
+      H_occupied(nullptr),
       use_swap(use_swap),
       use_orient_in_heuristic(use_orient_in_heuristic),
       executor(_ins->G.height,_ins->G.width),
       use_external_executor(use_external_executor),
-      disable_agent_goals(disable_agent_goals)
+      disable_agent_goals(disable_agent_goals),
+      arena(arena!=nullptr?arena:&own_arena)
 {
 }
 
@@ -229,21 +301,31 @@ Solution Planner::solve(std::string& additional_info, int order_strategy)
   solver_info(1, "start search");
 
   // setup agents
-  for (auto i = 0; i < N; ++i) A[i] = new Agent(i);
+  for (auto i = 0; i < N; ++i) A[i] = arena->create<Agent>(i);
+  H_occupied = nullptr;
+  moved.clear();
 
   // setup search
   auto OPEN = std::stack<HNode*>();
-  auto EXPLORED = std::unordered_map<Config, HNode*, ConfigHasher, Config::ConfigEqual>();
+  auto EXPLORED = ExploredTable(ins->planning_window > 0);
   // insert initial node, 'H': high-level node
-  auto H_init = new HNode(ins->starts, HT, ins, nullptr, 0, get_h_value(ins->starts), 0, order_strategy, disable_agent_goals);
+  auto H_init = arena->create<HNode>(ins->starts, HT, ins, nullptr, 0.0f, get_h_value(ins->starts), 0, order_strategy, disable_agent_goals, arena);
   OPEN.push(H_init);
-  EXPLORED[H_init->C] = H_init;
+  EXPLORED.insert(H_init);
 
   std::vector<Config> solution;
   auto C_new = Config(N);  // for new configuration
   HNode* H_goal = nullptr;          // to store goal node
 
 
+  // reused by every expansion.
+  std::vector<::State> curr_states;
+  std::vector<::State> planned_next_states;
+  std::vector<::State> next_states;
+  curr_states.reserve(N);
+  planned_next_states.reserve(N);
+  next_states.reserve(N);
+
   int d_max=INT_MAX/2;
   if (ins->planning_window>0) {
     d_max=ins->planning_window;
@@ -255,6 +337,14 @@ Solution Planner::solve(std::string& additional_info, int order_strategy)
 
     // do not pop here!
     auto H = OPEN.top();  // high-level node
+
+    // another planner of the portfolio has a solution at least as good as any through H
+    if (cost_bound != nullptr &&
+        bound_g_weight * H->g + bound_h_weight * H->h >= cost_bound->load(std::memory_order_relaxed)) {
+      ++bound_pruned_cnt;
+      OPEN.pop();
+      continue;
+    }
   
     // cerr<<"configs "<<H->d<<" "<<H->C<<endl;
 
@@ -273,10 +363,15 @@ Solution Planner::solve(std::string& additional_info, int order_strategy)
     //   break;
     // }
 
-    // if we find a depth d_max valid solution, then we just return it
+    // if we find a depth d_max valid solution, then we just return it, unless we are refining it.
     if (H->d>=d_max) {
-      H_goal=H;
-      break;
+      if (!anytime) {
+        H_goal=H;
+        break;
+      }
+      OPEN.pop();
+      if (H_goal == nullptr || H->f < H_goal->f) update_goal(H, H_goal);
+      continue;
     }
 
     // low-level search end
@@ -293,9 +388,8 @@ Solution Planner::solve(std::string& additional_info, int order_strategy)
 
     // check goal condition
     if (H_goal == nullptr && H->C.all_arrived()) {
-      H_goal = H;
-      solver_info(1, "found solution, cost: ", H->g);
-      if (objective == OBJ_NONE) break;
+      update_goal(H, H_goal);
+      if (objective == OBJ_NONE && !anytime) break;
       continue;
     }
 
@@ -305,8 +399,13 @@ Solution Planner::solve(std::string& additional_info, int order_strategy)
     expand_lowlevel_tree(H, L);
 
     // create successors at the high-level search
+    // L stays in the arena, its children point to it.
+    ONLYDEV(auto get_new_config_start = std::chrono::steady_clock::now();)
     const auto res = get_new_config(H, L);
-    delete L;  // free
+    ONLYDEV(
+      get_new_config_ms += std::chrono::duration<double>(std::chrono::steady_clock::now() - get_new_config_start).count() * 1000;
+      ++get_new_config_cnt;
+    )
     if (!res) continue;
 
     // create successors at the high-level search
@@ -354,17 +453,13 @@ Solution Planner::solve(std::string& additional_info, int order_strategy)
 
     
       // we need map no rotation action to rotation action here and create the new configuration for the next step.
-      std::vector<::State> curr_states;
-      std::vector<::State> planned_next_states;
-      std::vector<::State> next_states;
-      
-      curr_states.reserve(N);
-      planned_next_states.reserve(N);
-      next_states.reserve(N);
+      curr_states.clear();
+      planned_next_states.clear();
+      next_states.clear();
 
       for (int i=0;i<N;++i){
-        // cerr<<"ddd "<<i<<" "<<H->C.locs[i]->index<<" "<<H->C.orients[i]<<" "<<A[i]->v_next->index<<endl;
-        curr_states.emplace_back(H->C.locs[i]->index,0,H->C.orients[i]);
+        // cerr<<"ddd "<<i<<" "<<H->C.locs[i]<<" "<<H->C.orients[i]<<" "<<A[i]->v_next->index<<endl;
+        curr_states.emplace_back(H->C.locs[i],0,H->C.orients[i]);
         planned_next_states.emplace_back(A[i]->v_next->index,-1,-1);
         next_states.emplace_back(-1,-1,-1);
       }
@@ -375,62 +470,43 @@ Solution Planner::solve(std::string& additional_info, int order_strategy)
 
       // create new configuration
       for (int i=0;i<N;++i) {
-        C_new.locs[i] = ins->G.U[next_states[i].location];
-        C_new.orients[i] = next_states[i].orientation;
-        C_new.arrivals[i] = H->C.arrivals[i] | (next_states[i].location==ins->goals.locs[i]->index);
+        C_new.set(i,next_states[i].location,next_states[i].orientation);
+        C_new.set_arrival(i,H->C.arrived(i) || next_states[i].location==ins->goals.locs[i]);
       }
 
     } else {
 
       for (int i=0;i<N;++i) {
-        C_new.locs[i] = A[i]->v_next;
-        C_new.orients[i] = get_neighbor_orientation(ins->G,A[i]->v_now->index,A[i]->v_next->index,H->C.orients[i]);
-        C_new.arrivals[i] = H->C.arrivals[i] | (A[i]->v_next->index==ins->goals.locs[i]->index);
+        C_new.set(i,A[i]->v_next->index,get_neighbor_orientation(ins->G,A[i]->v_now->index,A[i]->v_next->index,H->C.orients[i]));
+        C_new.set_arrival(i,H->C.arrived(i) || A[i]->v_next->index==ins->goals.locs[i]);
       }
 
     }
 
     // check explored list
-    // const auto iter = EXPLORED.find(C_new);
-    // if (iter != EXPLORED.end()) {
-    //   cout<<"iter "<<loop_cnt<<": state exists. stucked, e.g., deadlock!"<<endl; // stucked
-    //   // I explicitly fail here. We can remove EXPLORED checking if we allow deadlock, e.g., in the competition. 
-    //   // or we can considering introducing more randomness to simply avoid deadlock.
-    //   // this piece of code is used for backtracking in the LaCAM!
-    //   // case found
-    //   exit(-1); 
-    //   rewrite(H, iter->second, H_goal, OPEN);
-    //   // re-insert or random-restart
-    //   auto H_insert = (MT != nullptr && get_random_float(MT) >= RESTART_RATE)
-    //                       ? iter->second
-    //                       : H_init;
-    //   if (H_goal == nullptr || H_insert->f < H_goal->f) OPEN.push(H_insert);
-    // } else {
-    //   // insert new search node
-    //   const auto H_new = new HNode(
-    //       C_new, HT, ins, H, H->g + get_edge_cost(H->C, C_new), get_h_value(C_new), H->d + 1, order_strategy, disable_agent_goals);
-    //   EXPLORED[H_new->C] = H_new;
-    //   if (H_goal == nullptr || H_new->f < H_goal->f) OPEN.push(H_new);
-    // }
-
-    // no check explored list
-    // insert new search node
-    const auto H_new = new HNode(
-        C_new, HT, ins, H, H->g + get_edge_cost(H->C, C_new), get_h_value(C_new), H->d + 1, order_strategy, disable_agent_goals);
-    // EXPLORED[H_new->C] = H_new;
-    if (H_goal == nullptr || H_new->f < H_goal->f) OPEN.push(H_new);
+    const auto H_explored = EXPLORED.find(C_new, H->d + 1);
+    if (H_explored != nullptr) {
+      // known configuration (at the same depth if windowed), e.g., reached from another parent: rewire instead of expanding it again.
+      const float g_goal = H_goal != nullptr ? H_goal->g : 0;
+      rewrite(H, H_explored, H_goal, OPEN);
+      if (H_goal != nullptr && H_goal->g < g_goal) update_goal(H_goal, H_goal);
+      // re-insert or random-restart
+      auto H_insert = (MT != nullptr && get_random_float(MT) >= RESTART_RATE)
+                          ? H_explored
+                          : H_init;
+      if (H_goal == nullptr || H_insert->f < H_goal->f) OPEN.push(H_insert);
+    } else {
+      // insert new search node
+      const auto H_new = arena->create<HNode>(
+          C_new, HT, ins, H, H->g + get_edge_cost(H->C, C_new), get_h_value(C_new), H->d + 1, order_strategy, disable_agent_goals, arena);
+      EXPLORED.insert(H_new);
+      if (H_goal == nullptr || H_new->f < H_goal->f) OPEN.push(H_new);
+    }
 
   }
 
   // backtrack
-  if (H_goal != nullptr) {
-    auto H = H_goal;
-    while (H != nullptr) {
-      solution.push_back(H->C);
-      H = H->parent;
-    }
-    std::reverse(solution.begin(), solution.end());
-  }
+  if (H_goal != nullptr) solution = backtrack(H_goal);
 
   // print result
   if (H_goal != nullptr && OPEN.empty()) {
@@ -449,14 +525,30 @@ Solution Planner::solve(std::string& additional_info, int order_strategy)
   additional_info += "objective=" + std::to_string(objective) + "\n";
   additional_info += "loop_cnt=" + std::to_string(loop_cnt) + "\n";
   additional_info += "num_node_gen=" + std::to_string(EXPLORED.size()) + "\n";
+  ONLYDEV(additional_info += "get_new_config_ms=" + std::to_string(get_new_config_ms) + "\n";)
 
   // memory management
-  for (auto a : A) delete a;
-  for (auto itr : EXPLORED) delete itr.second;
+  // free all nodes and agents at once, including the nodes not in EXPLORED.
+  arena->reset();
+
+  return solution;
+}
 
+Solution Planner::backtrack(HNode* H_goal)
+{
+  Solution solution;
+  for (auto H = H_goal; H != nullptr; H = H->parent) solution.push_back(H->C);
+  std::reverse(solution.begin(), solution.end());
   return solution;
 }
 
+void Planner::update_goal(HNode* H, HNode*& H_goal)
+{
+  solver_info(1, H_goal == nullptr ? "found solution, cost: " : "improved solution, cost: ", H->f);
+  H_goal = H;
+  if (on_solution) on_solution(backtrack(H_goal), H_goal->f);
+}
+
 void Planner::rewrite(HNode* H_from, HNode* H_to, HNode* H_goal,
                       std::stack<HNode*>& OPEN)
 {
@@ -489,7 +581,7 @@ float Planner::get_edge_cost(const Config& C1, const Config& C2)
   if (objective == OBJ_SUM_OF_LOSS) {
     float cost = 0;
     for (uint i = 0; i < N; ++i) {
-      if ((!C1.arrivals[i] || !C2.arrivals[i])) {
+      if ((!C1.arrived(i) || !C2.arrived(i))) {
         cost += 1;
       }
     }
@@ -509,89 +601,14 @@ float Planner::get_h_value(const Config& C)
 {
   float cost = 0;
   if (objective == OBJ_MAKESPAN) {
-    for (auto i = 0; i < N; ++i) cost = std::max(cost, HT->get(C.locs[i]->index, C.orients[i], ins->goals.locs[i]->index)*(float)(1-C.arrivals[i]));
+    for (auto i = 0; i < N; ++i) cost = std::max(cost, HT->get(C.locs[i], C.orients[i], ins->goals.locs[i])*(float)(1-C.arrived(i)));
   } else if (objective == OBJ_SUM_OF_LOSS) {
-    for (auto i = 0; i < N; ++i) cost += HT->get(C.locs[i]->index, C.orients[i], ins->goals.locs[i]->index)*(float)(1-C.arrivals[i]);
+    for (auto i = 0; i < N; ++i) cost += HT->get(C.locs[i], C.orients[i], ins->goals.locs[i])*(float)(1-C.arrived(i));
   }
   return cost;
 }
 
 
-std::vector<std::tuple<Vertex *,int> > Planner::get_successors(Vertex *v, int orient) {
-#ifdef NO_ROT
-  cerr<<"NO_ROT is not supported now"<<endl;
-  exit(-1);
-#else
-  std::vector<std::tuple<Vertex *,int> > successors;
-  int pos=v->index;
-  int rows=ins->G.height;
-  int cols=ins->G.width;
-  int x=pos%cols;
-  int y=pos/cols;
-
-  // forward
-  int next_pos;
-  if (orient==0) {
-      // east
-      if (x+1<cols){
-          next_pos=pos+1;
-          auto nv=ins->G.U[next_pos];
-          if (nv!=nullptr) {
-              successors.emplace_back(nv,orient);
-          }
-      }
-  } else if (orient==1) {
-      // south
-      if (y+1<rows) {
-          next_pos=pos+cols;
-          auto nv=ins->G.U[next_pos];
-          if (nv!=nullptr) {
-              successors.emplace_back(nv,orient);
-          }
-      }
-  } else if (orient==2) {
-      // west
-      if (x-1>=0) {
-          next_pos=pos-1;
-          auto nv=ins->G.U[next_pos];
-          if (nv!=nullptr) {
-              successors.emplace_back(nv,orient);
-          }
-      }
-  } else if (orient==3) {
-      // north
-      if (y-1>=0) {
-          next_pos=pos-cols;
-          auto nv=ins->G.U[next_pos];
-          if (nv!=nullptr) {
-              successors.emplace_back(nv,orient);
-          }
-      }
-  } else {
-      std::cerr<<"spatial search in heuristics: invalid orient: "<<orient<<endl;
-      exit(-1);
-  } 
-
-  int next_orient;
-  const int n_orients=4;
-
-  // CR
-  next_orient=(orient+1+n_orients)%n_orients;
-  successors.emplace_back(v,next_orient);
-
-  // CCR
-  next_orient=(orient-1+n_orients)%n_orients;
-  successors.emplace_back(v,next_orient);
-
-  // W
-  successors.emplace_back(v,orient);
-
-  return successors;
-#endif
-}
-
-
-
 void Planner::expand_lowlevel_tree(HNode* H, LNode* L)
 {
   if (L->depth >= N) return;
@@ -599,31 +616,32 @@ void Planner::expand_lowlevel_tree(HNode* H, LNode* L)
   // auto C = H->C.locs[i]->neighbor;
   // C.push_back(H->C.locs[i]);
 
-  auto successors=get_successors(H->C.locs[i],H->C.orients[i]);
+  std::tuple<Vertex*,int> successors[StateGraph::max_degree];
+  int n_successors=0;
+  for (auto & e : HT->state_graph->successors(H->C.locs[i],H->C.orients[i])) {
+    successors[n_successors++]=std::make_tuple(ins->G.U[e.to_pos],(int)e.to_orient);
+  }
 
   // randomize
-  if (MT != nullptr) std::shuffle(successors.begin(), successors.end(), *MT);
+  if (MT != nullptr) std::shuffle(successors, successors + n_successors, *MT);
   // insert
-  for (auto s : successors) H->search_tree.push(new LNode(L, i, s));
+  for (int k=0;k<n_successors;++k) H->search_tree.push(arena->create<LNode>(L, i, successors[k]));
 }
 
 bool Planner::get_new_config(HNode* H, LNode* L)
 {
-  // setup cache
-  for (auto a : A) {
-    // clear previous cache
-    if (a->v_now != nullptr && occupied_now[a->v_now->id] == a) {
-      occupied_now[a->v_now->id] = nullptr;
-    }
-    if (a->v_next != nullptr) {
-      occupied_next[a->v_next->id] = nullptr;
-      a->v_next = nullptr;
+  // setup cache. v_now only changes with H, and only the agents moved by the previous call need a reset.
+  if (H != H_occupied) {
+    occupied_now.clear();
+    for (auto a : A) {
+      a->v_now = ins->G.U[H->C.locs[a->id]];
+      occupied_now.set(a->v_now->id, a);
     }
-
-    // set occupied now
-    a->v_now = H->C.locs[a->id];
-    occupied_now[a->v_now->id] = a;
+    H_occupied = H;
   }
+  for (auto a : moved) a->v_next = nullptr;
+  moved.clear();
+  occupied_next.clear();
 
   // for (int i=0;i<occupied_next.size();++i){
   //   if (occupied_next[i]!=nullptr) {
@@ -632,10 +650,10 @@ bool Planner::get_new_config(HNode* H, LNode* L)
   //   }
   // }
 
-  // add constraints
-  for (uint k = 0; k < L->depth; ++k) {
-    const auto i = L->who[k];        // agent
-    const auto l = std::get<0>(L->where[k])->id;  // loc
+  // add constraints, from the deepest one to the root. the checks are pairwise, so the order does not matter.
+  for (auto constraint = L; constraint->parent != nullptr; constraint = constraint->parent) {
+    const auto i = constraint->who;        // agent
+    const auto l = constraint->where->id;  // loc
 
     // check vertex collision
     if (occupied_next[l] != nullptr){
@@ -644,7 +662,7 @@ bool Planner::get_new_config(HNode* H, LNode* L)
       return false;
     }
     // check swap collision
-    auto l_pre = H->C.locs[i]->id;
+    auto l_pre = ins->G.U[H->C.locs[i]]->id;
     if (occupied_next[l_pre] != nullptr && occupied_now[l] != nullptr &&
         occupied_next[l_pre]->id == occupied_now[l]->id) {
           // cerr<<"swap collision"<<endl;
@@ -653,23 +671,88 @@ bool Planner::get_new_config(HNode* H, LNode* L)
     }
 
     // set occupied_next
-    A[i]->v_next = std::get<0>(L->where[k]);
-    occupied_next[l] = A[i];
+    A[i]->v_next = constraint->where;
+    occupied_next.set(l, A[i]);
+    moved.push_back(A[i]);
   }
 
-  // perform PIBT
-  for (auto k : H->order) {
-    auto a = A[k];
-    if (a->v_next == nullptr && !funcPIBT(a,H)){
-      // cerr<<"planning failture"<<endl;
-      // exit(-1);
-      return false;  // planning failure
-    } 
+  // perform PIBT. with bands, every slice of the priority order plans the inner agents of the bands first.
+  const size_t n_slices = pibt_tiles > 1 ? std::max(1, pibt_slices) : 1;
+  for (size_t s = 0; s < n_slices; ++s) {
+    const size_t first = H->order.size() * s / n_slices;
+    const size_t last = H->order.size() * (s + 1) / n_slices;
+    if (pibt_tiles > 1 && !funcPIBT_tiles(H, first, last)) return false;
+    for (size_t j = first; j < last; ++j) {
+      auto a = A[H->order[j]];
+      if (a->v_next == nullptr && !funcPIBT(a,H)){
+        // cerr<<"planning failture"<<endl;
+        // exit(-1);
+        return false;  // planning failure
+      }
+    }
   }
   return true;
 }
 
 
+void Planner::setup_tiles()
+{
+  // vertex ids are row-major, so equal id ranges are bands with the same number of free cells.
+  tile_of.assign(V_size, 0);
+  tile_border.assign(V_size, false);
+  for (auto v : ins->G.V) tile_of[v->id] = (int)((size_t)v->id * pibt_tiles / V_size);
+  for (auto v : ins->G.V) {
+    for (auto u : v->neighbor) {
+      if (tile_of[u->id] != tile_of[v->id]) tile_border[v->id] = true;
+    }
+  }
+  tile_agents.assign(pibt_tiles, {});
+  tile_moved.assign(pibt_tiles, {});
+  tile_deferred.assign(pibt_tiles, false);
+}
+
+// a band only reserves its own vertices and only pushes its own agents, so the bands are independent
+// and the result does not depend on the number of threads.
+bool Planner::funcPIBT_tiles(HNode* H, size_t first, size_t last)
+{
+  if (tile_agents.size() != pibt_tiles) setup_tiles();
+  for (auto& agents : tile_agents) agents.clear();
+  for (size_t j = first; j < last; ++j) {
+    const auto k = H->order[j];
+    auto a = A[k];
+    if (a->v_next == nullptr && !tile_border[a->v_now->id])
+      tile_agents[tile_of[a->v_now->id]].push_back(k);
+  }
+
+  // more threads than cores only add waiting, the bands are then planned in turn.
+  const int n_threads = std::min(pibt_tiles, omp_get_max_threads());
+  bool success = true;
+  #pragma omp parallel for num_threads(n_threads) schedule(dynamic) reduction(&&:success)
+  for (int t = 0; t < pibt_tiles; ++t) {
+    auto& moved = tile_moved[t];
+    moved.clear();
+    for (auto k : tile_agents[t]) {
+      auto a = A[k];
+      if (a->v_next != nullptr) continue;
+      const auto mark = moved.size();
+      if (funcPIBT(a, H, t)) continue;
+      if (!tile_deferred[t]) {
+        success = false;
+        break;
+      }
+      // undo the chain. every vertex it reserved is the v_next of an agent it moved, and was free before.
+      for (auto j = mark; j < moved.size(); ++j) {
+        if (moved[j]->v_next == nullptr) continue;
+        occupied_next.reset(moved[j]->v_next->id);
+        moved[j]->v_next = nullptr;
+      }
+      moved.resize(mark);
+      tile_deferred[t] = false;
+    }
+  }
+  for (auto& agents : tile_moved) moved.insert(moved.end(), agents.begin(), agents.end());
+  return success;
+}
 
 int get_o_dist(int o1, int o2) {
   return std::min((o2-o1+4)%4,(o1-o2+4)%4);
@@ -700,20 +783,22 @@ float Planner::get_cost_move(int pst, int ped) {
 
 }
 
-bool Planner::funcPIBT(Agent* ai, HNode * H)
+bool Planner::funcPIBT(Agent* ai, HNode * H, int tile)
 {
   const auto i = ai->id;
   const auto K = ai->v_now->neighbor.size();
+  auto& moved = tile < 0 ? this->moved : tile_moved[tile];
 
   // get candidates for next locations
   for (auto k = 0; k < K; ++k) {
     auto u = ai->v_now->neighbor[k];
     C_next[i][k] = u;
-    if (MT != nullptr)
+    if (MT != nullptr && tile < 0)
       tie_breakers[u->id] = get_random_float(MT);  // set tie-breaker
   }
   C_next[i][K] = ai->v_now;
-  tie_breakers[ai->v_now->id] = get_random_float(MT);  // set tie-breaker
+  if (tile < 0)
+    tie_breakers[ai->v_now->id] = get_random_float(MT);  // set tie-breaker
 
   // for (int j=0;j<K+1;++j){
   //     std::cerr<<"check C_next "<<j<<" "<<K<<endl;
@@ -724,17 +809,28 @@ bool Planner::funcPIBT(Agent* ai, HNode * H)
 
   int o0=H->C.orients[i];
   float cost_rot=(*map_weights)[ai->v_now->index*5+4];
+
+  // at most 4 neighbors and the current vertex, all towards the same goal.
+  int locs[5];
+  int orients[5];
+  float hs[5];
+  for (int k=0;k<=K;++k) {
+    locs[k]=C_next[i][k]->index;
+    orients[k]=get_neighbor_orientation(ins->G,ai->v_now->index,locs[k],o0);
+  }
+  HT->get_many(locs,orients,ins->goals.locs[i],hs,(int)K+1);
+
   for (int k=0;k<=K;++k) {
     auto & v=C_next[i][k];
-    int o1=get_neighbor_orientation(ins->G,ai->v_now->index,v->index,o0);
+    int o1=orients[k];
     int o_dist1=get_o_dist(o0,o1);
     float cost1=(float)o_dist1*cost_rot+get_cost_move(ai->v_now->index,v->index);
-    float d1=d1=HT->get(v->index,o1,ins->goals.locs[i]->index)+cost1;
+    float d1=hs[k]+cost1;
     int pre_d1=1;
     if (ins->precomputed_paths!=nullptr){
       auto & path=(*ins->precomputed_paths)[i];
       int j=H->d;
-      if (j<path.size()-1 && path[j].location==ai->v_now->index && path[j].orientation==o0) {
+      if (j+1<path.size() && path[j].location==ai->v_now->index && path[j].orientation==o0) {
           if (path[j+1].orientation==o1) { // && ((o1==o0 && path[j+1].location==v->index) || (o1!=o0))) {
             pre_d1=0;
             // break;
@@ -785,11 +881,11 @@ bool Planner::funcPIBT(Agent* ai, HNode * H)
 
   //   float d1,d2;
   //   if (use_orient_in_heuristic){
-  //     d1=HT->get(v->index,o1,ins->goals.locs[i]->index)+cost1;
-  //     d2=HT->get(u->index,o2,ins->goals.locs[i]->index)+cost2;      
+  //     d1=HT->get(v->index,o1,ins->goals.locs[i])+cost1;
+  //     d2=HT->get(u->index,o2,ins->goals.locs[i])+cost2;      
   //   } else {
-  //     d1=HT->get(v->index,ins->goals.locs[i]->index);
-  //     d2=HT->get(u->index,ins->goals.locs[i]->index);
+  //     d1=HT->get(v->index,ins->goals.locs[i]);
+  //     d2=HT->get(u->index,ins->goals.locs[i]);
   //   }
 
   //   // std::cout<<d1<<" "<<d2<<std::endl;
@@ -869,7 +965,7 @@ bool Planner::funcPIBT(Agent* ai, HNode * H)
   //       // }        
 
 
-  //       if (j<path.size()-1 && path[j].location==ai->v_now->index && path[j].orientation==o0) {
+  //       if (j+1<path.size() && path[j].location==ai->v_now->index && path[j].orientation==o0) {
   //         if (path[j+1].orientation==o1) { // && ((o1==o0 && path[j+1].location==v->index) || (o1!=o0))) {
   //           pre_d1=0;
   //           // break;
@@ -925,7 +1021,7 @@ bool Planner::funcPIBT(Agent* ai, HNode * H)
   // });
 
   Agent* swap_agent=nullptr;
-  if (use_swap) {
+  if (use_swap && tile < 0) {
     swap_agent = swap_possible_and_required(ai);
     if (swap_agent != nullptr)
       std::reverse(C_next[i].begin(), C_next[i].begin() + K + 1);
@@ -938,34 +1034,45 @@ bool Planner::funcPIBT(Agent* ai, HNode * H)
     // avoid vertex conflicts
     if (occupied_next[u->id] != nullptr) continue;
 
-    auto& ak = occupied_now[u->id];
+    auto ak = occupied_now[u->id];
 
     // avoid swap conflicts
     if (ak != nullptr && ak->v_next == ai->v_now) continue;
 
+    // an agent at a band border may need a move into another band, the whole push chain is left to the sequential pass
+    if (tile >= 0 && ak != nullptr && ak != ai && ak->v_next == nullptr && tile_border[u->id]) {
+      tile_deferred[tile] = true;
+      return false;
+    }
+
     // reserve next location
-    occupied_next[u->id] = ai;
+    occupied_next.set(u->id, ai);
     ai->v_next = u;
+    moved.push_back(ai);
 
     // priority inheritance
-    if (ak != nullptr && ak != ai && ak->v_next == nullptr && !funcPIBT(ak,H))
+    if (ak != nullptr && ak != ai && ak->v_next == nullptr && !funcPIBT(ak,H,tile)) {
+      if (tile >= 0 && tile_deferred[tile]) return false;
       continue;
+    }
 
     // success to plan next one step
     // pull swap_agent when applicable
-    if (use_swap) {
+    if (use_swap && tile < 0) {
       if (k == 0 && swap_agent != nullptr && swap_agent->v_next == nullptr &&
           occupied_next[ai->v_now->id] == nullptr) {
         swap_agent->v_next = ai->v_now;
-        occupied_next[swap_agent->v_next->id] = swap_agent;
+        occupied_next.set(swap_agent->v_next->id, swap_agent);
+        moved.push_back(swap_agent);
       }
     }
     return true;
   }
 
   // failed to secure node
-  occupied_next[ai->v_now->id] = ai;
+  occupied_next.set(ai->v_now->id, ai);
   ai->v_next = ai->v_now;
+  moved.push_back(ai);
   return false;
 }
 
@@ -1004,14 +1111,14 @@ bool Planner::is_swap_required(const uint pusher, const uint puller,
   auto v_puller = v_puller_origin;
   Vertex* tmp = nullptr;
   while (
-      HT->get(v_puller->index, ins->goals.locs[pusher]->index) < HT->get(v_pusher->index, ins->goals.locs[pusher]->index)
+      HT->get(v_puller->index, ins->goals.locs[pusher]) < HT->get(v_pusher->index, ins->goals.locs[pusher])
     ) {
     auto n = v_puller->neighbor.size();
     // remove agents who need not to move
     for (auto u : v_puller->neighbor) {
       auto a = occupied_now[u->id];
       if (u == v_pusher ||
-          (u->neighbor.size() == 1 && a != nullptr && ins->goals.locs[a->id] == u)) {
+          (u->neighbor.size() == 1 && a != nullptr && ins->goals.locs[a->id] == u->index)) {
         --n;
       } else {
         tmp = u;
@@ -1024,8 +1131,8 @@ bool Planner::is_swap_required(const uint pusher, const uint puller,
   }
 
   // judge based on distance
-  return (HT->get(v_pusher->index, ins->goals.locs[puller]->index) < HT->get(v_puller->index, ins->goals.locs[puller]->index)) &&
-          (HT->get(v_pusher->index, ins->goals.locs[pusher]->index) == 0 || HT->get(v_puller->index, ins->goals.locs[pusher]->index) < HT->get(v_pusher->index, ins->goals.locs[pusher]->index));
+  return (HT->get(v_pusher->index, ins->goals.locs[puller]) < HT->get(v_puller->index, ins->goals.locs[puller])) &&
+          (HT->get(v_pusher->index, ins->goals.locs[pusher]) == 0 || HT->get(v_puller->index, ins->goals.locs[pusher]) < HT->get(v_pusher->index, ins->goals.locs[pusher]));
 }
 
 // simulate whether the swap is possible
@@ -1039,7 +1146,7 @@ bool Planner::is_swap_possible(Vertex* v_pusher_origin, Vertex* v_puller_origin)
     for (auto u : v_puller->neighbor) {
       auto a = occupied_now[u->id];
       if (u == v_pusher ||
-          (u->neighbor.size() == 1 && a != nullptr && ins->goals.locs[a->id] == u)) {
+          (u->neighbor.size() == 1 && a != nullptr && ins->goals.locs[a->id] == u->index)) {
         --n;      // pull-impossible with u
       } else {
         tmp = u;  // pull-possible with u
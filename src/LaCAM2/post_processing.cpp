@@ -57,7 +57,7 @@ float get_makespan(const Instance& ins, const std::shared_ptr<HeuristicTable>& H
   if (solution.empty()) return 0;
   float c = 0;
   for (auto i=0;i<ins.N;++i) {
-    c = std::max(c,(float)(solution.size()-1) + HT->get(solution.back().locs[i]->index,solution.back().orients[i],ins.goals.locs[i]->index));
+    c = std::max(c,(float)(solution.size()-1) + HT->get(solution.back().locs[i],solution.back().orients[i],ins.goals.locs[i]));
   }
   return c;
 }
@@ -87,7 +87,7 @@ float get_sum_of_loss(const Instance& ins, const std::shared_ptr<HeuristicTable>
   const auto N = solution.front().size();
   const auto T = solution.size();
   for (size_t i = 0; i < N; ++i) {
-    c+= (float)(solution.size()-1) + HT->get(solution.back().locs[i]->index,solution.back().orients[i],ins.goals.locs[i]->index);
+    c+= (float)(solution.size()-1) + HT->get(solution.back().locs[i],solution.back().orients[i],ins.goals.locs[i]);
   }
   return c;
 }
@@ -96,7 +96,7 @@ float get_makespan_lower_bound(const Instance& ins, const std::shared_ptr<Heuris
 {
   float c = 0;
   for (size_t i = 0; i < ins.N; ++i) {
-    c = std::max(c, HT->get(ins.starts.locs[i]->index,ins.goals.locs[i]->index));
+    c = std::max(c, HT->get(ins.starts.locs[i],ins.goals.locs[i]));
   }
   return c;
 }
@@ -105,7 +105,7 @@ float get_sum_of_costs_lower_bound(const Instance& ins, const std::shared_ptr<He
 {
   float c = 0;
   for (size_t i = 0; i < ins.N; ++i) {
-    c += HT->get(ins.starts.locs[i]->index,ins.goals.locs[i]->index);
+    c += HT->get(ins.starts.locs[i],ins.goals.locs[i]);
   }
   return c;
 }
@@ -171,12 +171,12 @@ void make_log(const Instance& ins, const std::shared_ptr<HeuristicTable>& HT, co
   if (log_short) return;
   log << "starts=";
   for (size_t i = 0; i < ins.N; ++i) {
-    auto k = ins.starts.locs[i]->index;
+    auto k = ins.starts.locs[i];
     log << "(" << get_x(k) << "," << get_y(k) << "),";
   }
   log << "\ngoals=";
   for (size_t i = 0; i < ins.N; ++i) {
-    auto k = ins.goals.locs[i]->index;
+    auto k = ins.goals.locs[i];
     log << "(" << get_x(k) << "," << get_y(k) << "),";
   }
   log << "\nsolution=\n";
@@ -184,7 +184,7 @@ void make_log(const Instance& ins, const std::shared_ptr<HeuristicTable>& HT, co
     log << t << ":";
     auto C = solution[t];
     for (auto v : C.locs) {
-      log << "(" << get_x(v->index) << "," << get_y(v->index) << "),";
+      log << "(" << get_x(v) << "," << get_y(v) << "),";
     }
     log << "\n";
   }
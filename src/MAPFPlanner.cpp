@@ -215,6 +215,47 @@ std::string MAPFPlanner::load_map_weights(string weights_path) {
     return suffix;
 }
 
+std::shared_ptr<HeuristicTable> MAPFPlanner::build_heuristics(bool consider_rotation, const std::string & suffix) {
+    auto heuristics=std::make_shared<HeuristicTable>(env,map_weights,consider_rotation);
+    auto & heuristics_config=config["heuristics"];
+    heuristics->save_mmap_cache=read_param_json<bool>(heuristics_config,"save_mmap_cache",false);
+    heuristics->use_bit_parallel_bfs=read_param_json<bool>(heuristics_config,"bit_parallel_bfs",true);
+    heuristics->use_shared_memory=read_param_json<bool>(heuristics_config,"shared_memory",false);
+    heuristics->async_build=read_param_json<bool>(heuristics_config,"async",false);
+    heuristics->open_list=read_param_json<string>(heuristics_config,"open_list","auto");
+    string storage=read_param_json<string>(heuristics_config,"storage","float");
+    if (storage=="quantized") {
+        heuristics->quantized=true;
+    } else if (storage!="float") {
+        cerr<<"unknown heuristic storage: "<<storage<<endl;
+        exit(-1);
+    }
+    string layout=read_param_json<string>(heuristics_config,"layout","start_major");
+    if (layout=="goal_major") {
+        heuristics->goal_major=true;
+    } else if (layout!="start_major") {
+        cerr<<"unknown heuristic layout: "<<layout<<endl;
+        exit(-1);
+    }
+    string mode=read_param_json<string>(heuristics_config,"mode","full");
+    if (mode=="lazy" || mode=="landmark") {
+        heuristics->lazy=true;
+        heuristics->lazy_cache_mb=read_param_json<int>(heuristics_config,"cache_mb",1024);
+        prefetch_heuristics=read_param_json<bool>(heuristics_config,"prefetch",true);
+        if (mode=="landmark") {
+            heuristics->use_landmarks=true;
+            heuristics->n_landmarks=read_param_json<int>(heuristics_config,"n_landmarks",16);
+            heuristics->landmark_exact_cache=read_param_json<bool>(heuristics_config,"exact_cache",true);
+        }
+    } else if (mode!="full") {
+        cerr<<"unknown heuristic mode: "<<mode<<endl;
+        exit(-1);
+    }
+    heuristics->preprocess(suffix);
+    this->heuristics=heuristics;
+    return heuristics;
+}
+
 void MAPFPlanner::initialize(int preprocess_time_limit) {
     cout << "planner initialization begins" << endl;
     load_configs();
@@ -250,8 +291,7 @@ void MAPFPlanner::initialize(int preprocess_time_limit) {
             exit(-1);
         }
 
-        auto heuristics =std::make_shared<HeuristicTable>(env,map_weights,read_param_json<bool>(config["LaCAM2"],"use_orient_in_heuristic"));
-        heuristics->preprocess(suffix);
+        auto heuristics=build_heuristics(read_param_json<bool>(config["LaCAM2"],"use_orient_in_heuristic"),suffix);
         int max_agents_in_use=read_param_json<int>(config,"max_agents_in_use",-1);
         if (max_agents_in_use==-1) {
             max_agents_in_use=env->num_of_agents;
@@ -266,8 +306,7 @@ void MAPFPlanner::initialize(int preprocess_time_limit) {
             std::cerr<<"In LNS, must not consider rotation when compiled with NO_ROT unset"<<std::endl;
             exit(-1);
         }
-        auto heuristics =std::make_shared<HeuristicTable>(env,map_weights,true);
-        heuristics->preprocess(suffix);
+        auto heuristics=build_heuristics(true,suffix);
         //heuristics->preprocess();
         int max_agents_in_use=read_param_json<int>(config,"max_agents_in_use",-1);
         if (max_agents_in_use==-1) {
@@ -314,6 +353,23 @@ void MAPFPlanner::plan(int time_limit,vector<Action> & actions)
         return;
     }
 
+    if (prefetch_heuristics) {
+        // current goals first, then the revealed ones in order.
+        std::vector<int> goals;
+        for (size_t k=0;;++k) {
+            size_t n_goals=goals.size();
+            for (int i=0;i<env->num_of_agents;++i) {
+                if (k<env->goal_locations[i].size()) {
+                    goals.push_back(env->goal_locations[i][k].first);
+                }
+            }
+            if (goals.size()==n_goals) {
+                break;
+            }
+        }
+        heuristics->prefetch(goals);
+    }
+
     if (lifelong_solver_name=="RHCR") {
         cout<<"using RHCR"<<endl;
         rhcr_solver->plan(*env);
@@ -321,7 +377,7 @@ void MAPFPlanner::plan(int time_limit,vector<Action> & actions)
     } else if (lifelong_solver_name=="LaCAM2") {
         ONLYDEV(cout<<"using LaCAM2"<<endl;)
         ONLYDEV(g_timer.record_p("mapf_lacam2_plan_s");)
-        lacam2_solver->plan(*env);
+        lacam2_solver->plan(*env,nullptr,nullptr,nullptr,time_limit*1000);
         ONLYDEV(g_timer.record_d("mapf_lacam2_plan_s","mapf_lacam2_plan");)
         ONLYDEV(g_timer.record_p("mapf_lacam2_get_step_s");)
         lacam2_solver->get_step_actions(*env,actions);
@@ -647,7 +703,7 @@ void MAPFPlanner::plan(int time_limit,vector<Action> & actions)
 
    if (lifelong_solver_name=="LaCAM2") {
         cout<<"using LaCAM2"<<endl;
-        lacam2_solver->plan(*env);
+        lacam2_solver->plan(*env,nullptr,nullptr,nullptr,time_limit*1000);
         lacam2_solver->get_step_actions(*env,actions);
     } else if (lifelong_solver_name=="LNS") {
         cout<<"using LNS"<<endl;
@@ -7,6 +7,7 @@
 #include <signal.h>
 #include <climits>
 #include <memory>
+#include "util/HeuristicTable.h"
 
 
 #ifdef PYTHON
@@ -30,6 +31,7 @@ void sigint_handler(int a)
     {
         system_ptr->saveResults(vm["output"].as<std::string>(),vm["outputScreen"].as<int>());
     }
+    HeuristicTable::release_all_shm();
     _exit(0);
 }
 
@@ -169,5 +171,6 @@ int main(int argc, char **argv)
 
     delete model;
     delete logger;
+    HeuristicTable::release_all_shm();
     _exit(0);
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include <boost/program_options.hpp>
 #include <iostream>
 #include <signal.h>
+#include "util/HeuristicTable.h"
 
 namespace po = boost::program_options;
 
@@ -12,6 +13,7 @@ void sigint_handler(int a) {
     if (server_ptr) {
         server_ptr->stop();
     }
+    HeuristicTable::release_all_shm();
     _exit(0);
 }
 
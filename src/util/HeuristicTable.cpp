@@ -1,4 +1,53 @@
 #include "util/HeuristicTable.h"
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <thread>
+#include <mutex>
+#include <algorithm>
+#include <climits>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+// the references to shared tables held by this process. a signal handler may release them,
+// so this is a fixed array of atomics instead of a locked list.
+#define MAX_SHM_TABLES 16
+struct ShmTableSlot {
+    std::atomic<bool> used;
+    std::atomic<HeuristicShmControl *> control;
+    char name[NAME_MAX+1];
+};
+static ShmTableSlot shm_slots[MAX_SHM_TABLES];
+static_assert(std::atomic<int32_t>::is_always_lock_free && std::atomic<HeuristicShmControl *>::is_always_lock_free);
+
+// reserve a slot for the table of the given name, -1 if all of them are taken.
+static int claim_shm_slot(const string & name) {
+    if (name.size()>NAME_MAX)
+        return -1;
+    for (int i=0;i<MAX_SHM_TABLES;++i) {
+        bool expected=false;
+        if (shm_slots[i].used.compare_exchange_strong(expected,true)) {
+            strcpy(shm_slots[i].name,name.c_str());
+            return i;
+        }
+    }
+    return -1;
+}
+
+// drop the reference of a slot, return true if it was the last one and the name is removed.
+// only atomics and shm_unlink, so it is async-signal-safe. the exchange drops a reference at most once.
+static bool release_shm_slot(int slot) {
+    auto control=shm_slots[slot].control.exchange(nullptr);
+    if (control!=nullptr && control->refcount.fetch_sub(1)==1) {
+        shm_unlink(shm_slots[slot].name);
+        return true;
+    }
+    return false;
+}
     
     
 HeuristicTable::HeuristicTable(SharedEnvironment * _env, const std::shared_ptr<std::vector<float> > & map_weights, bool consider_rotation):
@@ -36,25 +85,174 @@ HeuristicTable::HeuristicTable(SharedEnvironment * _env, const std::shared_ptr<s
     ONLYDEV(assert(loc_idx==loc_size);)
 
     state_size = loc_size*n_orientations;
-    main_heuristics = new float[loc_size*loc_size];
-    std::fill(main_heuristics,main_heuristics+loc_size*loc_size,MAX_HEURISTIC);
-    // we keep start_loc, end_loc, start_orient, namely no goal_orient
-    if (consider_rotation)
-        sub_heuristics = new float[state_size*loc_size];
+
+    state_graph = std::make_shared<StateGraph>(env,*map_weights);
 };
 
 HeuristicTable::~HeuristicTable() {
+    if (build_thread.joinable()) {
+        stop_build.store(true);
+        build_thread.join();
+    }
+    delete [] row_ready;
+    release_shm();
+    if (shm_fd!=-1) {
+        close(shm_fd);
+    }
+    if (shm_addr!=nullptr && shm_addr!=mmap_addr) {
+        munmap(shm_addr,shm_size);
+    }
     delete [] empty_locs;
     delete [] loc_idxs;
-    delete [] main_heuristics;
-    if (consider_rotation)
+    delete [] cached_rows;
+    delete [] row_of_goal;
+    delete [] goal_of_row;
+    delete [] row_version;
+    delete [] row_last_used;
+    delete [] landmark_dists_from;
+    delete [] landmark_dists_to;
+    for (auto planner: free_planners) {
+        delete planner;
+    }
+    if (mmap_addr!=nullptr) {
+        munmap(mmap_addr,mmap_size);
+    } else {
+        delete [] main_heuristics;
         delete [] sub_heuristics;
+        delete [] main_heuristics_q;
+        delete [] sub_heuristics_q;
+    }
+}
+
+// the tables are allocated lazily, because they are not needed if we can mmap a cache file.
+void HeuristicTable::alloc_tables() {
+    // in the quantized mode, the float main table only lives during computation.
+    main_heuristics = new float[loc_size*loc_size];
+    std::fill(main_heuristics,main_heuristics+loc_size*loc_size,MAX_HEURISTIC);
+    // we keep start_loc, end_loc, start_orient, namely no goal_orient
+    if (consider_rotation) {
+        if (quantized) {
+            // the sub heuristic is at most two rotations at the start location, so its scale is known in advance.
+            float max_rotation=0;
+            for (int loc_idx=0;loc_idx<loc_size;++loc_idx) {
+                max_rotation=std::max(max_rotation,(*map_weights)[empty_locs[loc_idx]*5+4]);
+            }
+            float max_diff=2*max_rotation;
+            if (weights_are_integral() && max_diff<=MAX_QUANTIZED_SUB) {
+                sub_scale=1;
+            } else {
+                sub_scale=std::max(max_diff,FLT_MIN)/MAX_QUANTIZED_SUB;
+            }
+            sub_heuristics_q = new uint8_t[state_size*loc_size];
+        } else {
+            sub_heuristics = new float[state_size*loc_size];
+        }
+    }
+}
+
+bool HeuristicTable::weights_are_integral() {
+    for (auto w: *map_weights) {
+        if (w!=std::floor(w)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// whether all actions at empty locations cost the same, then heuristics are just bfs levels.
+bool HeuristicTable::has_uniform_weights(float & weight) {
+    weight=(*map_weights)[empty_locs[0]*5];
+    for (int loc_idx=0;loc_idx<loc_size;++loc_idx) {
+        for (int dir=0;dir<5;++dir) {
+            if ((*map_weights)[empty_locs[loc_idx]*5+dir]!=weight) {
+                return false;
+            }
+        }
+    }
+    return weight>0;
+}
+
+// Dial's queue for integral weights, otherwise a radix heap.
+void HeuristicTable::select_open_list() {
+    float max_cost=0;
+    for (int loc_idx=0;loc_idx<loc_size;++loc_idx) {
+        for (int dir=0;dir<5;++dir) {
+            max_cost=std::max(max_cost,(*map_weights)[empty_locs[loc_idx]*5+dir]);
+        }
+    }
+    max_weight=(int)std::ceil(max_cost);
+
+    if (open_list=="auto") {
+        // too many buckets are slower to scan than the radix heap.
+        if (weights_are_integral() && max_weight<=(1<<16)) {
+            open_list_type=UTIL::SPATIAL::OL_DIAL;
+        } else {
+            open_list_type=UTIL::SPATIAL::OL_RADIX_HEAP;
+        }
+    } else if (open_list=="binary_heap") {
+        open_list_type=UTIL::SPATIAL::OL_BINARY_HEAP;
+    } else if (open_list=="dial") {
+        if (!weights_are_integral()) {
+            cerr<<"the dial open list requires integral weights"<<endl;
+            exit(-1);
+        }
+        open_list_type=UTIL::SPATIAL::OL_DIAL;
+    } else if (open_list=="radix_heap") {
+        open_list_type=UTIL::SPATIAL::OL_RADIX_HEAP;
+    } else {
+        cerr<<"unknown heuristic open list: "<<open_list<<endl;
+        exit(-1);
+    }
+    DEV_DEBUG("heuristic open list: {} (type {}, max weight {})", open_list, (int)open_list_type, max_weight);
+}
+
+UTIL::SPATIAL::SpatialAStar * HeuristicTable::new_planner(int n_orients) {
+    return new UTIL::SPATIAL::SpatialAStar(env,n_orients,*map_weights,open_list_type,max_weight);
+}
+
+// convert the float main table into fixed-point values with a per-table scale.
+void HeuristicTable::quantize_main_heuristics() {
+    float max_cost=0;
+    for (size_t i=0;i<loc_size*loc_size;++i) {
+        if (main_heuristics[i]<MAX_HEURISTIC) {
+            max_cost=std::max(max_cost,main_heuristics[i]);
+        }
+    }
+
+    // keep distances exact if they are integers that fit.
+    if (weights_are_integral() && max_cost<=MAX_QUANTIZED_MAIN) {
+        main_scale=1;
+    } else {
+        main_scale=std::max(max_cost,FLT_MIN)/MAX_QUANTIZED_MAIN;
+    }
+
+    main_heuristics_q = new uint16_t[loc_size*loc_size];
+    for (size_t i=0;i<loc_size*loc_size;++i) {
+        if (main_heuristics[i]<MAX_HEURISTIC) {
+            // round down, so that the decoded distance stays a lower bound
+            main_heuristics_q[i]=(uint16_t)std::min((float)MAX_QUANTIZED_MAIN,std::floor(main_heuristics[i]/main_scale));
+        } else {
+            main_heuristics_q[i]=UINT16_MAX;
+        }
+    }
+
+    delete [] main_heuristics;
+    main_heuristics=nullptr;
+
+    DEV_DEBUG("quantized heuristics with main scale {} and sub scale {}", main_scale, sub_scale);
 }
 
 // weights is an array of [loc_size*n_orientations]
 void HeuristicTable::compute_weighted_heuristics(){
+    float uniform_weight;
+    if (use_bit_parallel_bfs && has_uniform_weights(uniform_weight)) {
+        compute_uniform_heuristics(uniform_weight);
+        return;
+    }
+
+    // g_timer is not thread-safe and this may run on the background build thread.
     DEV_DEBUG("[start] Compute heuristics.");
-    ONLYDEV(g_timer.record_p("heu/compute_start");)
+    auto start = std::chrono::steady_clock::now();
 
     int n_threads=omp_get_max_threads();
     // BS::thread_pool pool(n_threads);
@@ -64,24 +262,26 @@ void HeuristicTable::compute_weighted_heuristics(){
     float * values = new float[n_threads*n_orientations*state_size];
     UTIL::SPATIAL::SpatialAStar ** planners= new UTIL::SPATIAL::SpatialAStar* [n_threads];
     for (int i=0;i<n_threads;++i) {
-        planners[i]=new UTIL::SPATIAL::SpatialAStar(env,n_orientations,*map_weights);
+        planners[i]=new_planner(n_orientations);
     }
 
     cerr<<"created"<<endl;
 
     int ctr=0;
     int step=100;
-    auto start = std::chrono::steady_clock::now();
 
     #pragma omp parallel for schedule(dynamic,1)
     for (int loc_idx=0;loc_idx<loc_size;++loc_idx)
     {
+        if (stop_build.load(std::memory_order_relaxed))
+            continue;
+
         int thread_id=omp_get_thread_num();
 
         int s_idx=thread_id*n_orientations*state_size;
 
         _compute_weighted_heuristics(loc_idx,values+s_idx,planners[thread_id]);
-
+        publish_rows(loc_idx,1);
 
         #pragma omp critical
         {
@@ -108,9 +308,90 @@ void HeuristicTable::compute_weighted_heuristics(){
     }
     delete planners;
 
-    ONLYDEV(g_timer.record_d("heu/compute_start","heu/compute_end","heu/compute");)
+    DEV_DEBUG("[end] Compute heuristics. (duration: {:.3f})", std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count());
+}
+
+void HeuristicTable::compute_uniform_heuristics(float weight) {
+    DEV_DEBUG("[start] Compute uniform heuristics with bit-parallel bfs.");
+    auto start = std::chrono::steady_clock::now();
+
+    typedef UTIL::SPATIAL::DefaultBitParallelBFS BFS;
+    int n_threads=omp_get_max_threads();
+    int sources_per_batch=BFS::n_lanes/n_orientations;
+    int n_batches=(int)((loc_size+sources_per_batch-1)/sources_per_batch);
+    cout<<"number of threads used for heuristic computation: "<<n_threads<<", sources per batch: "<<sources_per_batch<<endl;
+
+    std::vector<BFS *> searches(n_threads,nullptr);
 
-    DEV_DEBUG("[end] Compute heuristics. (duration: {:.3f})", g_timer.get_d("heu/compute"));
+    int ctr=0;
+    int step=std::max(1,100/sources_per_batch);
+
+    #pragma omp parallel for schedule(dynamic,1)
+    for (int batch=0;batch<n_batches;++batch)
+    {
+        if (stop_build.load(std::memory_order_relaxed))
+            continue;
+
+        int thread_id=omp_get_thread_num();
+        if (searches[thread_id]==nullptr) {
+            searches[thread_id]=new BFS(env,n_orientations,empty_locs,loc_idxs,(int)loc_size);
+        }
+
+        int start_loc_idx=batch*sources_per_batch;
+        int n_sources=std::min((int)loc_size-start_loc_idx,sources_per_batch);
+        std::vector<int> sources(n_sources);
+        for (int i=0;i<n_sources;++i) {
+            sources[i]=start_loc_idx+i;
+        }
+
+        // unreachable pairs keep MAX_HEURISTIC in the main table and 0 in the sub table.
+        if (consider_rotation) {
+            size_t begin=(size_t)start_loc_idx*state_size;
+            size_t end=begin+(size_t)n_sources*state_size;
+            if (quantized) {
+                std::fill(sub_heuristics_q+begin,sub_heuristics_q+end,0);
+            } else {
+                std::fill(sub_heuristics+begin,sub_heuristics+end,0);
+            }
+        }
+
+        // levels only grow, so the first lane of a source reaching a location gives the main heuristic.
+        searches[thread_id]->search(sources.data(),n_sources,[&](int lane, int loc_idx, int level) {
+            int source_loc_idx=start_loc_idx+lane/n_orientations;
+            float cost=(float)level*weight;
+            size_t main_idx=(size_t)source_loc_idx*loc_size+loc_idx;
+            if (main_heuristics[main_idx]==MAX_HEURISTIC) {
+                main_heuristics[main_idx]=cost;
+            }
+            if (consider_rotation) {
+                size_t sub_idx=main_idx*n_orientations+lane%n_orientations;
+                float diff=cost-main_heuristics[main_idx];
+                if (quantized) {
+                    sub_heuristics_q[sub_idx]=quantize_sub(diff);
+                } else {
+                    sub_heuristics[sub_idx]=diff;
+                }
+            }
+        });
+        publish_rows(start_loc_idx,n_sources);
+
+        #pragma omp critical
+        {
+            ++ctr;
+            if (ctr%step==0){
+                auto end = std::chrono::steady_clock::now();
+                double elapse=std::chrono::duration<double>(end-start).count();
+                double estimated_remain=elapse/ctr*(n_batches-ctr);
+                cout<<ctr<<"/"<<n_batches<<" batches completed in "<<elapse<<"s. estimated time to finish all: "<<estimated_remain<<"s.  estimated total time: "<<(estimated_remain+elapse)<<"s."<<endl;
+            }
+        }
+    }
+
+    for (auto search: searches) {
+        delete search;
+    }
+
+    DEV_DEBUG("[end] Compute uniform heuristics. (duration: {:.3f})", std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count());
 }
 
 void HeuristicTable::_compute_weighted_heuristics(
@@ -192,12 +473,780 @@ void HeuristicTable::_compute_weighted_heuristics(
                     std::cerr<<"diff: "<<diff<<" > "<<MAX_HEURISTIC<<endl;
                     exit(-1);
                 }
-                sub_heuristics[sub_idx]=diff;
+                if (quantized) {
+                    sub_heuristics_q[sub_idx]=quantize_sub(diff);
+                } else {
+                    sub_heuristics[sub_idx]=diff;
+                }
+            }
+        }
+    }
+}
+
+// out[(j*n+i)*k+c]=in[(i*n+j)*k+c], blocked to stay in cache. in is freed.
+template <typename T>
+static T * transpose_square(T * in, size_t n, size_t k) {
+    const size_t block=64;
+    T * out=new T[n*n*k];
+    for (size_t i0=0;i0<n;i0+=block) {
+        for (size_t j0=0;j0<n;j0+=block) {
+            size_t i1=std::min(n,i0+block);
+            size_t j1=std::min(n,j0+block);
+            for (size_t i=i0;i<i1;++i) {
+                for (size_t j=j0;j<j1;++j) {
+                    std::copy(in+(i*n+j)*k,in+(i*n+j+1)*k,out+(j*n+i)*k);
+                }
+            }
+        }
+    }
+    delete [] in;
+    return out;
+}
+
+// the tables are computed start-major, convert them to the goal-major layout.
+void HeuristicTable::transpose_tables() {
+    DEV_DEBUG("[start] Transpose heuristics to the goal-major layout.");
+    ONLYDEV(g_timer.record_p("heu/transpose_start");)
+    if (quantized) {
+        main_heuristics_q=transpose_square(main_heuristics_q,loc_size,1);
+        if (consider_rotation)
+            sub_heuristics_q=transpose_square(sub_heuristics_q,loc_size,n_orientations);
+    } else {
+        main_heuristics=transpose_square(main_heuristics,loc_size,1);
+        if (consider_rotation)
+            sub_heuristics=transpose_square(sub_heuristics,loc_size,n_orientations);
+    }
+    ONLYDEV(g_timer.record_d("heu/transpose_start","heu/transpose_end","heu/transpose");)
+    DEV_DEBUG("[end] Transpose heuristics to the goal-major layout. (duration: {:.3f})", g_timer.get_d("heu/transpose"));
+}
+
+void HeuristicTable::publish_rows(int start_loc_idx, int n_rows) {
+    if (row_ready==nullptr)
+        return;
+    for (int i=0;i<n_rows;++i) {
+        row_ready[start_loc_idx+i].store(1,std::memory_order_release);
+    }
+}
+
+// compute the tables on a background thread, each row becomes exact as soon as it is published.
+void HeuristicTable::start_async_build(const string & mmap_fpath) {
+    min_move_weight=FLT_MAX;
+    min_rotate_weight=FLT_MAX;
+    for (int loc_idx=0;loc_idx<loc_size;++loc_idx) {
+        for (int dir=0;dir<4;++dir) {
+            min_move_weight=std::min(min_move_weight,(*map_weights)[empty_locs[loc_idx]*5+dir]);
+        }
+        min_rotate_weight=std::min(min_rotate_weight,(*map_weights)[empty_locs[loc_idx]*5+4]);
+    }
+
+    row_ready=new std::atomic<uint8_t>[loc_size];
+    for (int loc_idx=0;loc_idx<loc_size;++loc_idx) {
+        row_ready[loc_idx].store(0,std::memory_order_relaxed);
+    }
+    build_done.store(false,std::memory_order_release);
+
+    DEV_DEBUG("compute heuristics in the background, min move weight {} and min rotate weight {}", min_move_weight, min_rotate_weight);
+    build_thread=std::thread([this,mmap_fpath]() {
+        compute_weighted_heuristics();
+        if (stop_build.load()) {
+            return;
+        }
+        build_done.store(true,std::memory_order_release);
+        if (save_mmap_cache) {
+            save_mmap(mmap_fpath);
+        }
+    });
+}
+
+void HeuristicTable::wait_for_build() {
+    if (build_thread.joinable()) {
+        build_thread.join();
+    }
+}
+
+// an admissible bound for rows not computed yet: every move costs at least min_move_weight,
+// and we have to rotate until we have faced every direction towards the goal.
+float HeuristicTable::get_fallback(int loc_idx1, int orient1, int loc_idx2) {
+    int pos1=empty_locs[loc_idx1];
+    int pos2=empty_locs[loc_idx2];
+    int dx=pos2%env.cols-pos1%env.cols;
+    int dy=pos2/env.cols-pos1/env.cols;
+    float cost=(float)(abs(dx)+abs(dy))*min_move_weight;
+    if (!consider_rotation) {
+        return cost;
+    }
+
+    // E,S,W,N, -1 if not needed
+    int dir_x=dx>0?0:(dx<0?2:-1);
+    int dir_y=dy>0?1:(dy<0?3:-1);
+    int n_rotations=0;
+    if (orient1==-1) {
+        // the best start orientation still has to turn once if both axes are needed.
+        n_rotations=(dir_x!=-1 && dir_y!=-1)?1:0;
+    } else {
+        auto rotations=[&](int dir) {
+            int diff=abs(orient1-dir);
+            return std::min(diff,n_orientations-diff);
+        };
+        if (dir_x!=-1 && dir_y!=-1) {
+            n_rotations=std::min(rotations(dir_x),rotations(dir_y))+1;
+        } else if (dir_x!=-1) {
+            n_rotations=rotations(dir_x);
+        } else if (dir_y!=-1) {
+            n_rotations=rotations(dir_y);
+        }
+    }
+    return cost+(float)n_rotations*min_rotate_weight;
+}
+
+void HeuristicTable::init_lazy_cache() {
+    row_size=loc_size;
+    if (consider_rotation)
+        row_size+=state_size;
+
+    max_cached_rows=lazy_cache_mb*1024*1024/(sizeof(float)*row_size);
+    max_cached_rows=std::max((size_t)1,std::min(max_cached_rows,loc_size));
+    n_cached_rows=0;
+
+    cached_rows=new float[max_cached_rows*row_size];
+    row_of_goal=new std::atomic<int>[loc_size];
+    for (size_t i=0;i<loc_size;++i) {
+        row_of_goal[i].store(-1,std::memory_order_relaxed);
+    }
+    goal_of_row=new std::atomic<int>[max_cached_rows];
+    row_version=new std::atomic<uint32_t>[max_cached_rows];
+    row_last_used=new std::atomic<uint64_t>[max_cached_rows];
+    for (size_t i=0;i<max_cached_rows;++i) {
+        goal_of_row[i].store(-1,std::memory_order_relaxed);
+        row_version[i].store(0,std::memory_order_relaxed);
+        row_last_used[i].store(0,std::memory_order_relaxed);
+    }
+
+    DEV_DEBUG("lazy heuristics: at most {} cached rows of {} floats", max_cached_rows, row_size);
+}
+
+// reverse search from the goal, so one row holds the costs from all states to it.
+void HeuristicTable::compute_goal_row(int goal_loc_idx, float * row) {
+    UTIL::SPATIAL::SpatialAStar * planner=nullptr;
+    {
+        std::lock_guard<std::mutex> lock(planners_mutex);
+        if (!free_planners.empty()) {
+            planner=free_planners.back();
+            free_planners.pop_back();
+        }
+    }
+    if (planner==nullptr) {
+        planner=new_planner(n_orientations);
+    }
+
+    planner->reset();
+    planner->search_for_all_reverse(empty_locs[goal_loc_idx]);
+
+    float * sub_row=row+loc_size;
+    for (int loc_idx=0;loc_idx<loc_size;++loc_idx) {
+        int loc=empty_locs[loc_idx];
+        if (!consider_rotation) {
+            float cost=planner->all_states[loc].g;
+            row[loc_idx]=cost==-1?MAX_HEURISTIC:cost;
+        } else {
+            float costs[4];
+            float min_cost=MAX_HEURISTIC;
+            for (int orient=0;orient<n_orientations;++orient) {
+                float cost=planner->all_states[loc*n_orientations+orient].g;
+                costs[orient]=cost==-1?MAX_HEURISTIC:cost;
+                min_cost=std::min(min_cost,costs[orient]);
+            }
+            row[loc_idx]=min_cost;
+            for (int orient=0;orient<n_orientations;++orient) {
+                sub_row[loc_idx*n_orientations+orient]=min_cost<MAX_HEURISTIC?costs[orient]-min_cost:0;
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(planners_mutex);
+    free_planners.push_back(planner);
+}
+
+// copy a computed row into the cache, evicting the least recently used one if full.
+int HeuristicTable::install_goal_row(int goal_loc_idx, const float * row) {
+    std::lock_guard<std::mutex> lock(rows_mutex);
+    int slot=row_of_goal[goal_loc_idx].load(std::memory_order_relaxed);
+    if (slot==-1) {
+        if (n_cached_rows<max_cached_rows) {
+            slot=(int)n_cached_rows;
+            ++n_cached_rows;
+        } else {
+            slot=0;
+            uint64_t oldest=row_last_used[0].load(std::memory_order_relaxed);
+            for (size_t i=1;i<max_cached_rows;++i) {
+                uint64_t t=row_last_used[i].load(std::memory_order_relaxed);
+                if (t<oldest) {
+                    oldest=t;
+                    slot=(int)i;
+                }
             }
+            row_of_goal[goal_of_row[slot].load(std::memory_order_relaxed)].store(-1,std::memory_order_relaxed);
+        }
+        // readers that still see the old goal of the slot fail the version check.
+        uint32_t version=row_version[slot].load(std::memory_order_relaxed);
+        row_version[slot].store(version+1,std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        memcpy(cached_rows+slot*row_size,row,sizeof(float)*row_size);
+        goal_of_row[slot].store(goal_loc_idx,std::memory_order_relaxed);
+        row_version[slot].store(version+2,std::memory_order_release);
+        row_of_goal[goal_loc_idx].store(slot,std::memory_order_release);
+    }
+    row_last_used[slot].store(row_clock.fetch_add(1,std::memory_order_relaxed)+1,std::memory_order_relaxed);
+    return slot;
+}
+
+bool HeuristicTable::find_cached(int loc_idx1, int orient1, int loc_idx2, float & h) {
+    if (max_cached_rows==0)
+        return false;
+    int slot=row_of_goal[loc_idx2].load(std::memory_order_acquire);
+    if (slot==-1)
+        return false;
+
+    uint32_t version=row_version[slot].load(std::memory_order_acquire);
+    if (version&1)
+        return false;
+    const float * row=cached_rows+slot*row_size;
+    h=row[loc_idx1];
+    if (orient1!=-1)
+        h+=row[loc_size+loc_idx1*n_orientations+orient1];
+    int goal=goal_of_row[slot].load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (goal!=loc_idx2 || row_version[slot].load(std::memory_order_relaxed)!=version)
+        return false;
+
+    // the clock only ticks on installs, so a hit is a plain load and rarely a store.
+    uint64_t now=row_clock.load(std::memory_order_relaxed);
+    if (row_last_used[slot].load(std::memory_order_relaxed)!=now)
+        row_last_used[slot].store(now,std::memory_order_relaxed);
+    return true;
+}
+
+bool HeuristicTable::build_goal_row(int goal_loc_idx, float * row) {
+    {
+        std::unique_lock<std::mutex> lock(pending_mutex);
+        if (pending_goals.count(goal_loc_idx)) {
+            pending_cv.wait(lock,[&]() { return pending_goals.count(goal_loc_idx)==0; });
+            return false;
+        }
+        pending_goals.insert(goal_loc_idx);
+    }
+
+    compute_goal_row(goal_loc_idx,row);
+    install_goal_row(goal_loc_idx,row);
+
+    {
+        std::lock_guard<std::mutex> lock(pending_mutex);
+        pending_goals.erase(goal_loc_idx);
+    }
+    pending_cv.notify_all();
+    return true;
+}
+
+// orient1=-1 means the main heuristic only.
+float HeuristicTable::get_lazy(int loc_idx1, int orient1, int loc_idx2) {
+    std::vector<float> row;
+    while (true) {
+        float h;
+        if (find_cached(loc_idx1,orient1,loc_idx2,h))
+            return h;
+
+        // only goals prefetched as hot are exact with landmarks.
+        if (use_landmarks) {
+            return get_landmark_bound(loc_idx1,loc_idx2);
+        }
+
+        // if another thread computed the row meanwhile, it is cached unless evicted already.
+        row.resize(row_size);
+        if (build_goal_row(loc_idx2,row.data())) {
+            if (orient1==-1)
+                return row[loc_idx1];
+            return row[loc_idx1]+row[loc_size+loc_idx1*n_orientations+orient1];
         }
     }
 }
 
+void HeuristicTable::prefetch(const std::vector<int> & goals) {
+    if (!lazy || max_cached_rows==0)
+        return;
+
+    std::vector<int> goal_loc_idxs;
+    unordered_set<int> seen;
+    for (auto goal: goals) {
+        int goal_loc_idx=loc_idxs[goal];
+        if (goal_loc_idx==-1 || seen.count(goal_loc_idx))
+            continue;
+        seen.insert(goal_loc_idx);
+        if (row_of_goal[goal_loc_idx].load(std::memory_order_acquire)==-1)
+            goal_loc_idxs.push_back(goal_loc_idx);
+        // goals are in order of urgency, don't evict rows we are about to prefetch.
+        if (seen.size()>=max_cached_rows)
+            break;
+    }
+
+    if (goal_loc_idxs.empty())
+        return;
+
+    ONLYDEV(g_timer.record_p("heu/prefetch_start");)
+
+    #pragma omp parallel for schedule(dynamic,1)
+    for (int i=0;i<goal_loc_idxs.size();++i) {
+        std::vector<float> row(row_size);
+        build_goal_row(goal_loc_idxs[i],row.data());
+    }
+
+    ONLYDEV(g_timer.record_d("heu/prefetch_start","heu/prefetch_end","heu/prefetch");)
+    DEV_DEBUG("prefetched {} heuristic rows. (duration: {:.3f})", goal_loc_idxs.size(), g_timer.get_d("heu/prefetch"));
+}
+
+// farthest-point selection: each landmark is the location farthest from the selected ones.
+void HeuristicTable::compute_landmarks() {
+    DEV_DEBUG("[start] Compute landmarks.");
+    ONLYDEV(g_timer.record_p("heu/landmarks_start");)
+
+    n_landmarks=std::max(1,std::min(n_landmarks,(int)loc_size));
+    landmark_dists_from=new float[loc_size*n_landmarks];
+    landmark_dists_to=new float[loc_size*n_landmarks];
+    landmarks.clear();
+
+    UTIL::SPATIAL::SpatialAStar planner(env,1,*map_weights,open_list_type,max_weight);
+    std::vector<float> min_dists(loc_size,MAX_HEURISTIC);
+
+    auto farthest=[&]() {
+        // unreachable locations come first, so that every component gets a landmark.
+        int best=0;
+        for (int loc_idx=1;loc_idx<loc_size;++loc_idx) {
+            if (min_dists[loc_idx]>min_dists[best]) {
+                best=loc_idx;
+            }
+        }
+        return best;
+    };
+
+    // the first landmark is the farthest from an arbitrary location.
+    planner.reset();
+    planner.search_for_all(empty_locs[0],-1);
+    for (int loc_idx=0;loc_idx<loc_size;++loc_idx) {
+        float cost=planner.all_states[empty_locs[loc_idx]].g;
+        min_dists[loc_idx]=cost==-1?MAX_HEURISTIC:cost;
+    }
+    int next_loc_idx=farthest();
+    std::fill(min_dists.begin(),min_dists.end(),MAX_HEURISTIC);
+
+    for (int k=0;k<n_landmarks;++k) {
+        int landmark=empty_locs[next_loc_idx];
+        landmarks.push_back(landmark);
+
+        planner.reset();
+        planner.search_for_all(landmark,-1);
+        for (int loc_idx=0;loc_idx<loc_size;++loc_idx) {
+            float cost=planner.all_states[empty_locs[loc_idx]].g;
+            cost=cost==-1?MAX_HEURISTIC:cost;
+            landmark_dists_from[(size_t)loc_idx*n_landmarks+k]=cost;
+            min_dists[loc_idx]=std::min(min_dists[loc_idx],cost);
+        }
+
+        planner.reset();
+        planner.search_for_all_reverse(landmark);
+        for (int loc_idx=0;loc_idx<loc_size;++loc_idx) {
+            float cost=planner.all_states[empty_locs[loc_idx]].g;
+            landmark_dists_to[(size_t)loc_idx*n_landmarks+k]=cost==-1?MAX_HEURISTIC:cost;
+        }
+
+        next_loc_idx=farthest();
+    }
+
+    ONLYDEV(g_timer.record_d("heu/landmarks_start","heu/landmarks_end","heu/landmarks");)
+    DEV_DEBUG("[end] Compute {} landmarks. (duration: {:.3f})", n_landmarks, g_timer.get_d("heu/landmarks"));
+}
+
+// max over landmarks L of d(L,g)-d(L,s) and d(s,L)-d(g,L).
+float HeuristicTable::get_landmark_bound(int loc_idx1, int loc_idx2) {
+    const float * from1=landmark_dists_from+(size_t)loc_idx1*n_landmarks;
+    const float * from2=landmark_dists_from+(size_t)loc_idx2*n_landmarks;
+    const float * to1=landmark_dists_to+(size_t)loc_idx1*n_landmarks;
+    const float * to2=landmark_dists_to+(size_t)loc_idx2*n_landmarks;
+
+    float bound=0;
+    for (int k=0;k<n_landmarks;++k) {
+        if (from1[k]<MAX_HEURISTIC) {
+            // L reaches s but not g, so s cannot reach g.
+            if (from2[k]>=MAX_HEURISTIC)
+                return MAX_HEURISTIC;
+            bound=std::max(bound,from2[k]-from1[k]);
+        }
+        if (to2[k]<MAX_HEURISTIC) {
+            // g reaches L but s doesn't, so s cannot reach g.
+            if (to1[k]>=MAX_HEURISTIC)
+                return MAX_HEURISTIC;
+            bound=std::max(bound,to1[k]-to2[k]);
+        }
+    }
+    return bound;
+}
+
+int HeuristicTable::neighbor_loc_idx(int loc_idx, int dir) {
+    int pos=empty_locs[loc_idx];
+    int x=pos%env.cols;
+    int y=pos/env.cols;
+    // right,down,left,up
+    if (dir==0) {
+        return x+1<env.cols?loc_idxs[pos+1]:-1;
+    } else if (dir==1) {
+        return y+1<env.rows?loc_idxs[pos+env.cols]:-1;
+    } else if (dir==2) {
+        return x-1>=0?loc_idxs[pos-1]:-1;
+    } else {
+        return y-1>=0?loc_idxs[pos-env.cols]:-1;
+    }
+}
+
+// predecessor states of a state in the rotation graph and the costs of their actions.
+void HeuristicTable::get_state_predecessors(int state, const std::vector<float> & weights, std::vector<std::pair<int,float> > & preds) {
+    preds.clear();
+    int loc_idx=state/n_orientations;
+    int orient=state%n_orientations;
+    int prev=neighbor_loc_idx(loc_idx,(orient+2)%4);
+    if (prev!=-1) {
+        preds.emplace_back(prev*n_orientations+orient,weights[empty_locs[prev]*5+orient]);
+    }
+    float rotation=weights[empty_locs[loc_idx]*5+4];
+    preds.emplace_back(loc_idx*n_orientations+(orient+1)%n_orientations,rotation);
+    preds.emplace_back(loc_idx*n_orientations+(orient-1+n_orientations)%n_orientations,rotation);
+}
+
+// a rotation row has to be recomputed if, for some start orientation, a decreased edge (x,y) now gives a cheaper y,
+// or an increased edge was tight and y has no other tight predecessor with the new weights.
+// the costs from all starts to these states come from reverse searches rooted at them.
+void HeuristicTable::find_affected_rows(
+    const std::vector<WeightChange> & changes,
+    const std::vector<float> & new_weights,
+    std::vector<char> & affected
+) {
+    struct ChangedEdge {
+        int tail;
+        int head;
+        float old_weight;
+        float new_weight;
+        // only for increased edges
+        std::vector<std::pair<int,float> > head_preds;
+    };
+
+    std::vector<ChangedEdge> edges;
+    for (auto & c: changes) {
+        if (c.dir<4) {
+            int v=neighbor_loc_idx(c.loc_idx,c.dir);
+            if (v!=-1) {
+                edges.push_back({c.loc_idx*n_orientations+c.dir,v*n_orientations+c.dir,c.old_weight,c.new_weight});
+            }
+        } else {
+            for (int orient=0;orient<n_orientations;++orient) {
+                int state=c.loc_idx*n_orientations+orient;
+                edges.push_back({state,c.loc_idx*n_orientations+(orient+1)%n_orientations,c.old_weight,c.new_weight});
+                edges.push_back({state,c.loc_idx*n_orientations+(orient-1+n_orientations)%n_orientations,c.old_weight,c.new_weight});
+            }
+        }
+    }
+
+    // from now on, edges refer to the indices of their states in roots.
+    std::vector<int> roots;
+    unordered_map<int,int> root_idxs;
+    auto to_root=[&](int & state) {
+        auto iter=root_idxs.find(state);
+        if (iter==root_idxs.end()) {
+            iter=root_idxs.emplace(state,(int)roots.size()).first;
+            roots.push_back(state);
+        }
+        state=iter->second;
+    };
+    for (auto & e: edges) {
+        if (e.new_weight>e.old_weight) {
+            get_state_predecessors(e.head,new_weights,e.head_preds);
+            for (auto & pred: e.head_preds) {
+                to_root(pred.first);
+            }
+        }
+        to_root(e.tail);
+        to_root(e.head);
+    }
+
+    // a reverse search costs a quarter of a row, so it is no longer worth it beyond loc_size roots.
+    if (roots.size()>=loc_size) {
+        std::fill(affected.begin(),affected.end(),1);
+        return;
+    }
+
+    // costs[root][start state]
+    std::vector<std::vector<float> > costs(roots.size());
+    #pragma omp parallel
+    {
+        auto planner=new_planner(n_orientations);
+        #pragma omp for schedule(dynamic,1)
+        for (int i=0;i<roots.size();++i) {
+            planner->reset();
+            planner->search_for_all_reverse(empty_locs[roots[i]/n_orientations],roots[i]%n_orientations);
+            costs[i].resize(state_size);
+            for (int loc_idx=0;loc_idx<loc_size;++loc_idx) {
+                for (int orient=0;orient<n_orientations;++orient) {
+                    float cost=planner->all_states[empty_locs[loc_idx]*n_orientations+orient].g;
+                    costs[i][loc_idx*n_orientations+orient]=cost==-1?MAX_HEURISTIC:cost;
+                }
+            }
+        }
+        delete planner;
+    }
+
+    auto is_tight=[](float dx, float w, float dy) {
+        return dx<MAX_HEURISTIC && dx+w<=dy+1e-5f*std::max(1.0f,dy);
+    };
+
+    #pragma omp parallel for schedule(dynamic,64)
+    for (int loc_idx=0;loc_idx<loc_size;++loc_idx) {
+        for (int orient=0;orient<n_orientations && !affected[loc_idx];++orient) {
+            int start=loc_idx*n_orientations+orient;
+            for (auto & e: edges) {
+                float dx=costs[e.tail][start];
+                float dy=costs[e.head][start];
+                bool changed=false;
+                if (e.new_weight<e.old_weight) {
+                    changed=dx<MAX_HEURISTIC && dx+e.new_weight<dy-1e-5f*std::max(1.0f,dy);
+                } else if (is_tight(dx,e.old_weight,dy)) {
+                    changed=true;
+                    for (auto & pred: e.head_preds) {
+                        if (pred.first!=e.tail && is_tight(costs[pred.first][start],pred.second,dy)) {
+                            changed=false;
+                            break;
+                        }
+                    }
+                }
+                if (changed) {
+                    affected[loc_idx]=1;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+// dynamic shortest paths on the location graph for one start (Ramalingam-Reps style).
+// first invalidate locations whose shortest paths all use an increased edge,
+// then a dijkstra from the invalidated locations and the heads of decreased edges repairs the row.
+void HeuristicTable::repair_location_row(
+    int start_loc_idx,
+    const std::vector<WeightChange> & changes,
+    const std::vector<float> & old_weights,
+    std::vector<char> & invalid
+) {
+    float * d=main_heuristics+(size_t)start_loc_idx*loc_size;
+    auto & new_weights=*map_weights;
+    typedef std::pair<float,int> Item;
+    std::priority_queue<Item,std::vector<Item>,std::greater<Item> > queue;
+
+    auto is_tight=[&](float du, float w, float dv) {
+        return du<MAX_HEURISTIC && du+w<=dv+1e-5f*std::max(1.0f,dv);
+    };
+
+    for (auto & c: changes) {
+        if (c.dir==4 || c.new_weight<=c.old_weight)
+            continue;
+        int v=neighbor_loc_idx(c.loc_idx,c.dir);
+        if (v!=-1 && is_tight(d[c.loc_idx],c.old_weight,d[v])) {
+            queue.emplace(d[v],v);
+        }
+    }
+
+    // in the order of old costs, a location is invalid if no valid predecessor still supports it.
+    std::vector<int> invalid_locs;
+    while (!queue.empty()) {
+        int v=queue.top().second;
+        queue.pop();
+        if (invalid[v] || v==start_loc_idx)
+            continue;
+
+        bool supported=false;
+        for (int dir=0;dir<4 && !supported;++dir) {
+            int u=neighbor_loc_idx(v,(dir+2)%4);
+            if (u!=-1 && !invalid[u] && is_tight(d[u],new_weights[empty_locs[u]*5+dir],d[v])) {
+                supported=true;
+            }
+        }
+        if (supported)
+            continue;
+
+        invalid[v]=1;
+        invalid_locs.push_back(v);
+        for (int dir=0;dir<4;++dir) {
+            int y=neighbor_loc_idx(v,dir);
+            if (y!=-1 && !invalid[y] && is_tight(d[v],old_weights[empty_locs[v]*5+dir],d[y])) {
+                queue.emplace(d[y],y);
+            }
+        }
+    }
+
+    for (auto v: invalid_locs) {
+        d[v]=MAX_HEURISTIC;
+    }
+
+    for (auto v: invalid_locs) {
+        for (int dir=0;dir<4;++dir) {
+            int u=neighbor_loc_idx(v,(dir+2)%4);
+            if (u!=-1 && !invalid[u] && d[u]<MAX_HEURISTIC) {
+                float cost=d[u]+new_weights[empty_locs[u]*5+dir];
+                if (cost<d[v]) {
+                    d[v]=cost;
+                }
+            }
+        }
+        if (d[v]<MAX_HEURISTIC) {
+            queue.emplace(d[v],v);
+        }
+    }
+
+    for (auto & c: changes) {
+        if (c.dir==4 || c.new_weight>=c.old_weight)
+            continue;
+        int v=neighbor_loc_idx(c.loc_idx,c.dir);
+        if (v!=-1 && d[c.loc_idx]<MAX_HEURISTIC && d[c.loc_idx]+c.new_weight<d[v]) {
+            d[v]=d[c.loc_idx]+c.new_weight;
+            queue.emplace(d[v],v);
+        }
+    }
+
+    while (!queue.empty()) {
+        auto item=queue.top();
+        queue.pop();
+        int u=item.second;
+        if (item.first>d[u])
+            continue;
+        for (int dir=0;dir<4;++dir) {
+            int y=neighbor_loc_idx(u,dir);
+            if (y==-1)
+                continue;
+            float cost=d[u]+new_weights[empty_locs[u]*5+dir];
+            if (cost<d[y]) {
+                d[y]=cost;
+                queue.emplace(cost,y);
+            }
+        }
+    }
+
+    for (auto v: invalid_locs) {
+        invalid[v]=0;
+    }
+}
+
+void HeuristicTable::clear_lazy_cache() {
+    std::lock_guard<std::mutex> lock(rows_mutex);
+    if (row_of_goal!=nullptr) {
+        for (size_t i=0;i<loc_size;++i) {
+            row_of_goal[i].store(-1,std::memory_order_relaxed);
+        }
+        for (size_t i=0;i<max_cached_rows;++i) {
+            goal_of_row[i].store(-1,std::memory_order_relaxed);
+        }
+    }
+    n_cached_rows=0;
+}
+
+void HeuristicTable::update_weights(const std::vector<float> & new_weights) {
+    wait_for_build();
+    if (new_weights.size()!=map_weights->size()) {
+        cerr<<"map weights size mismatch"<<endl;
+        exit(-1);
+    }
+    if (quantized || mmap_addr!=nullptr || goal_major) {
+        cerr<<"cannot update the weights of quantized, mmapped or goal-major heuristics"<<endl;
+        exit(-1);
+    }
+
+    DEV_DEBUG("[start] Update heuristics for new weights.");
+    ONLYDEV(g_timer.record_p("heu/update_start");)
+
+    std::vector<WeightChange> changes;
+    for (int loc_idx=0;loc_idx<loc_size;++loc_idx) {
+        for (int dir=0;dir<5;++dir) {
+            size_t idx=empty_locs[loc_idx]*5+dir;
+            if (new_weights[idx]!=(*map_weights)[idx]) {
+                changes.push_back({loc_idx,dir,(*map_weights)[idx],new_weights[idx]});
+            }
+        }
+    }
+
+    // rows are checked with the old weights, but computed with the new ones.
+    std::vector<char> affected;
+    if (!lazy && consider_rotation && !changes.empty()) {
+        affected.resize(loc_size,0);
+        find_affected_rows(changes,new_weights,affected);
+    }
+
+    std::vector<float> old_weights(*map_weights);
+    // the weights are shared with the solvers, so they see the new weights as well.
+    *map_weights=new_weights;
+    state_graph->update_weights(new_weights);
+    select_open_list();
+    {
+        std::lock_guard<std::mutex> lock(planners_mutex);
+        for (auto planner: free_planners) {
+            delete planner;
+        }
+        free_planners.clear();
+    }
+
+    if (changes.empty()) {
+        return;
+    }
+
+    if (lazy) {
+        if (use_landmarks) {
+            delete [] landmark_dists_from;
+            delete [] landmark_dists_to;
+            compute_landmarks();
+        }
+        clear_lazy_cache();
+    } else if (consider_rotation) {
+        int n_threads=omp_get_max_threads();
+        float * values = new float[n_threads*n_orientations*state_size];
+        std::vector<UTIL::SPATIAL::SpatialAStar *> planners(n_threads,nullptr);
+        int n_affected=0;
+
+        #pragma omp parallel for schedule(dynamic,1) reduction(+:n_affected)
+        for (int loc_idx=0;loc_idx<loc_size;++loc_idx) {
+            if (!affected[loc_idx])
+                continue;
+            int thread_id=omp_get_thread_num();
+            if (planners[thread_id]==nullptr) {
+                planners[thread_id]=new_planner(n_orientations);
+            }
+            size_t main_idx=(size_t)loc_idx*loc_size;
+            std::fill(main_heuristics+main_idx,main_heuristics+main_idx+loc_size,MAX_HEURISTIC);
+            _compute_weighted_heuristics(loc_idx,values+(size_t)thread_id*n_orientations*state_size,planners[thread_id]);
+            ++n_affected;
+        }
+
+        delete [] values;
+        for (auto planner: planners) {
+            delete planner;
+        }
+        DEV_DEBUG("{} weight changes, recomputed {}/{} rows", changes.size(), n_affected, loc_size);
+    } else {
+        #pragma omp parallel
+        {
+            std::vector<char> invalid(loc_size,0);
+            #pragma omp for schedule(dynamic,64)
+            for (int loc_idx=0;loc_idx<loc_size;++loc_idx) {
+                repair_location_row(loc_idx,changes,old_weights,invalid);
+            }
+        }
+    }
+
+    ONLYDEV(g_timer.record_d("heu/update_start","heu/update_end","heu/update");)
+    DEV_DEBUG("[end] Update heuristics for new weights. (duration: {:.3f})", g_timer.get_d("heu/update"));
+}
+
 void HeuristicTable::dump_main_heuristics(int start_loc, string file_path_prefix) {
     int start_loc_idx=loc_idxs[start_loc];
     if (start_loc_idx==-1) {
@@ -212,7 +1261,7 @@ void HeuristicTable::dump_main_heuristics(int start_loc, string file_path_prefix
             int target_loc_idx=loc_idxs[target_loc];
             float h=MAX_HEURISTIC;
             if (target_loc_idx!=-1){
-                h=main_heuristics[start_loc_idx*loc_size+target_loc_idx];
+                h=get(start_loc,target_loc);
             }
             fout<<h;
             if (j!=env.cols-1) {
@@ -387,7 +1436,19 @@ float HeuristicTable::get(int loc1, int loc2) {
         return MAX_HEURISTIC;
     }
 
-    size_t idx=loc_idx1*loc_size+loc_idx2;
+    if (lazy) {
+        return get_lazy(loc_idx1,-1,loc_idx2);
+    }
+
+    if (!build_done.load(std::memory_order_acquire) && !row_ready[loc_idx1].load(std::memory_order_acquire)) {
+        return get_fallback(loc_idx1,-1,loc_idx2);
+    }
+
+    size_t idx=main_index(loc_idx1,loc_idx2);
+    if (quantized) {
+        uint16_t q=main_heuristics_q[idx];
+        return q==UINT16_MAX?MAX_HEURISTIC:q*main_scale;
+    }
     return main_heuristics[idx];
 }
 
@@ -411,11 +1472,128 @@ float HeuristicTable::get(int loc1, int orient1, int loc2) {
     //         min_v=sub_heuristics[idx+i];
     //     }
     // }
-    size_t main_idx=loc_idx1*loc_size+loc_idx2;
-    size_t sub_idx=(loc_idx1*loc_size+loc_idx2)*n_orientations+orient1;
+    if (lazy) {
+        return get_lazy(loc_idx1,orient1,loc_idx2);
+    }
+
+    if (!build_done.load(std::memory_order_acquire) && !row_ready[loc_idx1].load(std::memory_order_acquire)) {
+        return get_fallback(loc_idx1,orient1,loc_idx2);
+    }
+
+    size_t main_idx=main_index(loc_idx1,loc_idx2);
+    size_t sub_idx=main_idx*n_orientations+orient1;
+    if (quantized) {
+        uint16_t q=main_heuristics_q[main_idx];
+        return q==UINT16_MAX?MAX_HEURISTIC:q*main_scale+sub_heuristics_q[sub_idx]*sub_scale;
+    }
     return main_heuristics[main_idx]+sub_heuristics[sub_idx];
 } 
 
+static bool cpu_has_avx2() {
+#if defined(__x86_64__) || defined(__i386__)
+    static const bool has_avx2=__builtin_cpu_supports("avx2");
+    return has_avx2;
+#else
+    return false;
+#endif
+}
+
+void HeuristicTable::get_many(const int * locs, const int * orients, int goal, float * out, int n) {
+    // only the full float tables in the goal-major layout keep the values towards a goal in one block.
+    int goal_loc_idx=loc_idxs[goal];
+    if (use_simd && goal_major && !quantized && !lazy && goal_loc_idx!=-1
+        && (orients==nullptr || consider_rotation) && cpu_has_avx2()) {
+        get_many_avx2(locs,orients,goal_loc_idx,out,n);
+        return;
+    }
+
+    for (int i=0;i<n;++i) {
+        out[i]=orients==nullptr?get(locs[i],goal):get(locs[i],orients[i],goal);
+    }
+}
+
+void HeuristicTable::get_many(const int * locs, const int * orients, const int * goals, float * out, int n) {
+    // the entries are scattered over the table, so gather them with 64-bit indices in either layout.
+    if (use_simd && !quantized && !lazy && build_done.load(std::memory_order_acquire)
+        && (orients==nullptr || consider_rotation) && cpu_has_avx2()) {
+        get_many_avx2(locs,orients,goals,out,n);
+        return;
+    }
+
+    for (int i=0;i<n;++i) {
+        out[i]=orients==nullptr?get(locs[i],goals[i]):get(locs[i],orients[i],goals[i]);
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// 8 sources per iteration, the last one is masked. invalid locations get MAX_HEURISTIC.
+__attribute__((target("avx2")))
+void HeuristicTable::get_many_avx2(const int * locs, const int * orients, int goal_loc_idx, float * out, int n) {
+    const float * main_block=main_heuristics+(size_t)goal_loc_idx*loc_size;
+    const float * sub_block=consider_rotation?sub_heuristics+(size_t)goal_loc_idx*state_size:nullptr;
+    const __m256i lanes=_mm256_setr_epi32(0,1,2,3,4,5,6,7);
+    const __m256i invalid=_mm256_set1_epi32(-1);
+    const __m256i n_orients=_mm256_set1_epi32(n_orientations);
+    const __m256 max_h=_mm256_set1_ps(MAX_HEURISTIC);
+    for (int i=0;i<n;i+=8) {
+        __m256i mask=_mm256_cmpgt_epi32(_mm256_set1_epi32(n-i),lanes);
+        __m256i loc=_mm256_maskload_epi32(locs+i,mask);
+        __m256i loc_idx=_mm256_mask_i32gather_epi32(invalid,loc_idxs,loc,mask,4);
+        __m256i bad=_mm256_cmpeq_epi32(loc_idx,invalid);
+        // masked-out and invalid lanes read the first entry of the block.
+        loc_idx=_mm256_andnot_si256(bad,loc_idx);
+        __m256 h=_mm256_i32gather_ps(main_block,loc_idx,4);
+        if (orients!=nullptr) {
+            __m256i orient=_mm256_maskload_epi32(orients+i,mask);
+            __m256i sub_idx=_mm256_add_epi32(_mm256_mullo_epi32(loc_idx,n_orients),orient);
+            h=_mm256_add_ps(h,_mm256_i32gather_ps(sub_block,sub_idx,4));
+        }
+        h=_mm256_blendv_ps(h,max_h,_mm256_castsi256_ps(bad));
+        _mm256_maskstore_ps(out+i,mask,h);
+    }
+}
+
+// 4 sources per iteration, as the indices into the whole table need 64 bits.
+__attribute__((target("avx2")))
+void HeuristicTable::get_many_avx2(const int * locs, const int * orients, const int * goals, float * out, int n) {
+    const __m128i lanes=_mm_setr_epi32(0,1,2,3);
+    const __m128i invalid=_mm_set1_epi32(-1);
+    const __m256i size=_mm256_set1_epi64x(loc_size);
+    const __m128 max_h=_mm_set1_ps(MAX_HEURISTIC);
+    for (int i=0;i<n;i+=4) {
+        __m128i mask=_mm_cmpgt_epi32(_mm_set1_epi32(n-i),lanes);
+        __m128i loc_idx1=_mm_mask_i32gather_epi32(invalid,loc_idxs,_mm_maskload_epi32(locs+i,mask),mask,4);
+        __m128i loc_idx2=_mm_mask_i32gather_epi32(invalid,loc_idxs,_mm_maskload_epi32(goals+i,mask),mask,4);
+        __m128i bad=_mm_or_si128(_mm_cmpeq_epi32(loc_idx1,invalid),_mm_cmpeq_epi32(loc_idx2,invalid));
+        // masked-out and invalid lanes read the first entry of the table.
+        __m256i idx1=_mm256_cvtepi32_epi64(_mm_andnot_si128(bad,loc_idx1));
+        __m256i idx2=_mm256_cvtepi32_epi64(_mm_andnot_si128(bad,loc_idx2));
+        __m256i main_idx=goal_major?
+            _mm256_add_epi64(_mm256_mul_epu32(idx2,size),idx1):
+            _mm256_add_epi64(_mm256_mul_epu32(idx1,size),idx2);
+        __m128 h=_mm256_i64gather_ps(main_heuristics,main_idx,4);
+        if (orients!=nullptr) {
+            // n_orientations is 4 with rotation
+            __m256i orient=_mm256_cvtepi32_epi64(_mm_maskload_epi32(orients+i,mask));
+            __m256i sub_idx=_mm256_add_epi64(_mm256_slli_epi64(main_idx,2),orient);
+            h=_mm_add_ps(h,_mm256_i64gather_ps(sub_heuristics,sub_idx,4));
+        }
+        h=_mm_blendv_ps(h,max_h,_mm_castsi128_ps(bad));
+        _mm_maskstore_ps(out+i,mask,h);
+    }
+}
+#else
+void HeuristicTable::get_many_avx2(const int * locs, const int * orients, int goal_loc_idx, float * out, int n) {
+    cerr<<"avx2 is not available on this platform"<<endl;
+    exit(-1);
+}
+
+void HeuristicTable::get_many_avx2(const int * locs, const int * orients, const int * goals, float * out, int n) {
+    cerr<<"avx2 is not available on this platform"<<endl;
+    exit(-1);
+}
+#endif
+
 // int HeuristicTable::get(int loc1, int orient1, int loc2, int orient2) {
 //     if (!consider_rotation) {
 //         cerr<<"no valid to use this func if not consider rotation"<<endl;
@@ -458,27 +1636,88 @@ float HeuristicTable::get(int loc1, int orient1, int loc2) {
 
 void HeuristicTable::preprocess(string suffix) {
 
+    select_open_list();
+
+    if (async_build && (lazy || quantized || use_shared_memory || goal_major)) {
+        cerr<<"the async heuristic build only supports the full start-major float tables in a single process"<<endl;
+        exit(-1);
+    }
+
+    if (lazy) {
+        if (quantized) {
+            cerr<<"the lazy heuristics only support the float storage"<<endl;
+            exit(-1);
+        }
+        if (use_shared_memory) {
+            cerr<<"the lazy heuristics cannot be shared between processes"<<endl;
+            exit(-1);
+        }
+        if (use_landmarks) {
+            compute_landmarks();
+        }
+        // nothing else to precompute, rows are built on demand.
+        if (!use_landmarks || landmark_exact_cache) {
+            init_lazy_cache();
+        }
+        return;
+    }
+
     string fname=env.map_name.substr(0,env.map_name.size()-4);
     string folder=env.file_storage_path;
     if (folder[folder.size()-1]!=boost::filesystem::path::preferred_separator){
         folder+=boost::filesystem::path::preferred_separator;
     }
-    string fpath;
+    string fpath_prefix;
     if (consider_rotation) {
-        fpath=folder+fname+"_weighted_heuristics_v4_"+suffix+".gz";
+        fpath_prefix=folder+fname+"_weighted_heuristics_v4_"+suffix;
     } else {
-        fpath=folder+fname+"_weighted_heuristics_no_rotation_v4_"+suffix+".gz";
+        fpath_prefix=folder+fname+"_weighted_heuristics_no_rotation_v4_"+suffix;
     }
+    string fpath=fpath_prefix+".gz";
+    string mmap_fpath=fpath_prefix+".bin";
 
-    if (boost::filesystem::exists(fpath)) {
-        load(fpath);
-    } else {
-        compute_weighted_heuristics();
-        // ONLYDEV(save(fpath));
+    // another process may have published the tables already, otherwise we become the creator.
+    if (use_shared_memory && open_shm(make_shm_name(fname))==1) {
+        return;
+    }
+
+    // prefer the uncompressed cache, it can be mapped without decompression.
+    if (!boost::filesystem::exists(mmap_fpath) || !load_mmap(mmap_fpath)) {
+        alloc_tables();
+        if (boost::filesystem::exists(fpath)) {
+            load(fpath);
+        } else if (async_build) {
+            start_async_build(mmap_fpath);
+            return;
+        } else {
+            compute_weighted_heuristics();
+            // ONLYDEV(save(fpath));
+        }
+
+        if (quantized) {
+            quantize_main_heuristics();
+        }
+
+        if (goal_major) {
+            transpose_tables();
+        }
+
+        if (save_mmap_cache) {
+            save_mmap(mmap_fpath);
+        }
+    }
+
+    if (shm_fd!=-1) {
+        publish_shm();
     }
 }
 
 void HeuristicTable::save(const string & fpath) {
+    if (quantized) {
+        cerr<<"the .gz heuristics format only supports the float storage"<<endl;
+        return;
+    }
+
     DEV_DEBUG("[start] Save heuristics to {}.", fpath);
     ONLYDEV(g_timer.record_p("heu/save_start");)
 
@@ -550,10 +1789,433 @@ void HeuristicTable::load(const string & fpath) {
     in.read((char *)main_heuristics,sizeof(float)*loc_size*loc_size);
     
     // load sub heuristics
-    if (consider_rotation)
-        in.read((char *)sub_heuristics,sizeof(float)*state_size*loc_size);
+    if (consider_rotation) {
+        if (quantized) {
+            // quantize row by row, so that the float sub table is never materialized.
+            std::vector<float> row(state_size);
+            for (size_t loc_idx=0;loc_idx<loc_size;++loc_idx) {
+                in.read((char *)row.data(),sizeof(float)*state_size);
+                for (size_t i=0;i<state_size;++i) {
+                    sub_heuristics_q[loc_idx*state_size+i]=quantize_sub(row[i]);
+                }
+            }
+        } else {
+            in.read((char *)sub_heuristics,sizeof(float)*state_size*loc_size);
+        }
+    }
 
     ONLYDEV(g_timer.record_d("heu/load_start","heu/load_end","heu/load");)
 
     DEV_DEBUG("[end] load heuristics from {}. (duration: {:.3f})",fpath,g_timer.get_d("heu/load"));
-}
\ No newline at end of file
+}
+
+static size_t align_to_page(size_t offset) {
+    size_t page_size=sysconf(_SC_PAGESIZE);
+    return (offset+page_size-1)/page_size*page_size;
+}
+
+// FNV-1a over the map and the weights, so a cache computed for other weights is never used.
+uint64_t HeuristicTable::compute_weights_hash() {
+    uint64_t h=14695981039346656037ULL;
+    auto update=[&](const void * data, size_t n) {
+        const unsigned char * bytes=(const unsigned char *)data;
+        for (size_t i=0;i<n;++i) {
+            h^=bytes[i];
+            h*=1099511628211ULL;
+        }
+    };
+    update(env.map.data(),sizeof(int)*env.map.size());
+    update(map_weights->data(),sizeof(float)*map_weights->size());
+    return h;
+}
+
+HeuristicFileHeader HeuristicTable::make_file_header() {
+    HeuristicFileHeader header;
+    memset(&header,0,sizeof(header));
+    memcpy(header.magic,HEURISTIC_FILE_MAGIC,sizeof(header.magic));
+    header.version=HEURISTIC_FILE_VERSION;
+    header.layout=HL_FLOAT_START_MAJOR;
+    if (quantized)
+        header.layout|=HL_QUANTIZED;
+    if (goal_major)
+        header.layout|=HL_GOAL_MAJOR;
+    header.rows=env.rows;
+    header.cols=env.cols;
+    header.loc_size=loc_size;
+    header.n_orientations=n_orientations;
+    header.weights_hash=compute_weights_hash();
+    header.main_scale=main_scale;
+    header.sub_scale=sub_scale;
+    size_t main_entry_size=quantized?sizeof(uint16_t):sizeof(float);
+    size_t sub_entry_size=quantized?sizeof(uint8_t):sizeof(float);
+    header.empty_locs_offset=align_to_page(HEURISTIC_SHM_CONTROL_OFFSET+sizeof(HeuristicShmControl));
+    header.main_offset=align_to_page(header.empty_locs_offset+sizeof(int)*loc_size);
+    header.sub_offset=align_to_page(header.main_offset+main_entry_size*loc_size*loc_size);
+    header.file_size=header.sub_offset;
+    if (consider_rotation)
+        header.file_size+=sub_entry_size*state_size*loc_size;
+    return header;
+}
+
+void HeuristicTable::save_mmap(const string & fpath) {
+    DEV_DEBUG("[start] Save uncompressed heuristics to {}.", fpath);
+    auto start = std::chrono::steady_clock::now();
+
+    auto header=make_file_header();
+
+    // write to a temporary file first, so that other processes never map a partial cache.
+    string tmp_fpath=fpath+".tmp"+std::to_string(getpid());
+    std::ofstream fout;
+    fout.open(tmp_fpath,std::ios::binary|std::ios::out);
+    if (!fout) {
+        cerr<<"failed to open "<<tmp_fpath<<" for writing heuristics"<<endl;
+        return;
+    }
+
+    fout.write((char *)&header,sizeof(header));
+    fout.seekp(header.empty_locs_offset);
+    fout.write((char *)empty_locs,sizeof(int)*loc_size);
+    fout.seekp(header.main_offset);
+    if (quantized) {
+        fout.write((char *)main_heuristics_q,sizeof(uint16_t)*loc_size*loc_size);
+    } else {
+        fout.write((char *)main_heuristics,sizeof(float)*loc_size*loc_size);
+    }
+    if (consider_rotation) {
+        fout.seekp(header.sub_offset);
+        if (quantized) {
+            fout.write((char *)sub_heuristics_q,sizeof(uint8_t)*state_size*loc_size);
+        } else {
+            fout.write((char *)sub_heuristics,sizeof(float)*state_size*loc_size);
+        }
+    }
+    fout.close();
+
+    if (!fout || std::rename(tmp_fpath.c_str(),fpath.c_str())!=0) {
+        cerr<<"failed to save heuristics to "<<fpath<<endl;
+        std::remove(tmp_fpath.c_str());
+        return;
+    }
+
+    DEV_DEBUG("[end] Save uncompressed heuristics to {}. (duration: {:.3f})", fpath, std::chrono::duration<double>(std::chrono::steady_clock::now()-start).count());
+}
+
+bool HeuristicTable::check_file_header(const HeuristicFileHeader & header, const HeuristicFileHeader & expected) {
+    return memcmp(header.magic,expected.magic,sizeof(header.magic))==0
+        && header.version==expected.version
+        && header.layout==expected.layout
+        && header.rows==expected.rows
+        && header.cols==expected.cols
+        && header.loc_size==expected.loc_size
+        && header.n_orientations==expected.n_orientations
+        && header.weights_hash==expected.weights_hash
+        && header.empty_locs_offset==expected.empty_locs_offset
+        && header.main_offset==expected.main_offset
+        && header.sub_offset==expected.sub_offset
+        && header.file_size==expected.file_size;
+}
+
+// return false if the file is not a valid cache for the current map and weights.
+bool HeuristicTable::load_mmap(const string & fpath) {
+    DEV_DEBUG("[start] mmap heuristics from {}.",fpath);
+    ONLYDEV(g_timer.record_p("heu/load_mmap_start");)
+
+    int fd=open(fpath.c_str(),O_RDONLY);
+    if (fd<0) {
+        cerr<<"failed to open "<<fpath<<endl;
+        return false;
+    }
+
+    struct stat st;
+    HeuristicFileHeader header;
+    auto expected=make_file_header();
+    if (fstat(fd,&st)!=0 || pread(fd,&header,sizeof(header),0)!=sizeof(header)) {
+        cerr<<"failed to read the header of "<<fpath<<endl;
+        close(fd);
+        return false;
+    }
+
+    if (!check_file_header(header,expected) || (uint64_t)st.st_size<header.file_size) {
+        cerr<<"the heuristic cache "<<fpath<<" is stale or corrupted, ignore it."<<endl;
+        close(fd);
+        return false;
+    }
+
+    void * addr=mmap(nullptr,header.file_size,PROT_READ,MAP_PRIVATE,fd,0);
+    close(fd);
+    if (addr==MAP_FAILED) {
+        cerr<<"failed to mmap "<<fpath<<endl;
+        return false;
+    }
+
+    // check empty locs
+    int * _empty_locs=(int *)((char *)addr+header.empty_locs_offset);
+    if (memcmp(_empty_locs,empty_locs,sizeof(int)*loc_size)!=0) {
+        cerr<<"the empty locations don't match!"<<endl;
+        munmap(addr,header.file_size);
+        return false;
+    }
+
+    mmap_addr=addr;
+    mmap_size=header.file_size;
+    if (quantized) {
+        main_scale=header.main_scale;
+        sub_scale=header.sub_scale;
+        main_heuristics_q=(uint16_t *)((char *)addr+header.main_offset);
+        if (consider_rotation)
+            sub_heuristics_q=(uint8_t *)((char *)addr+header.sub_offset);
+    } else {
+        main_heuristics=(float *)((char *)addr+header.main_offset);
+        if (consider_rotation)
+            sub_heuristics=(float *)((char *)addr+header.sub_offset);
+    }
+
+    ONLYDEV(g_timer.record_d("heu/load_mmap_start","heu/load_mmap_end","heu/load_mmap");)
+
+    DEV_DEBUG("[end] mmap heuristics from {}. (duration: {:.3f})",fpath,g_timer.get_d("heu/load_mmap"));
+    return true;
+}
+
+// keyed by the map, the layout and the weights, e.g. /lrr_heuristics_warehouse_small_r_fs_0123456789abcdef
+string HeuristicTable::make_shm_name(const string & fname) {
+    string name="/lrr_heuristics_";
+    for (auto c: fname) {
+        name+=isalnum(c)?c:'_';
+    }
+    name+=consider_rotation?"_r":"_n";
+    name+=quantized?"_q":"_f";
+    name+=goal_major?"g_":"s_";
+    name+=(boost::format("%016x") % compute_weights_hash()).str();
+    return name;
+}
+
+// return 1 if attached to a published table, 0 if we create it and must publish it later, -1 if sharing failed.
+int HeuristicTable::open_shm(const string & name) {
+    int slot=claim_shm_slot(name);
+    if (slot==-1) {
+        cerr<<"too many shared heuristics in one process, don't share "<<name<<endl;
+        return -1;
+    }
+
+    auto expected=make_file_header();
+    // 0 while we should retry
+    int ret=0;
+    for (int attempt=0;attempt<10;++attempt) {
+        int fd=shm_open(name.c_str(),O_RDWR|O_CREAT|O_EXCL,0600);
+        if (fd>=0) {
+            if (ftruncate(fd,expected.file_size)!=0) {
+                cerr<<"failed to resize the shared memory "<<name<<endl;
+                close(fd);
+                shm_unlink(name.c_str());
+                ret=-1;
+                break;
+            }
+            void * addr=mmap(nullptr,expected.file_size,PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+            if (addr==MAP_FAILED) {
+                cerr<<"failed to mmap the shared memory "<<name<<endl;
+                close(fd);
+                shm_unlink(name.c_str());
+                ret=-1;
+                break;
+            }
+            shm_fd=fd;
+            shm_name=name;
+            shm_addr=addr;
+            shm_size=expected.file_size;
+            shm_control=(HeuristicShmControl *)((char *)addr+HEURISTIC_SHM_CONTROL_OFFSET);
+            shm_control->refcount.store(1);
+            shm_control->creator_pid=getpid();
+            DEV_DEBUG("create shared heuristics {}", name);
+            ret=0;
+            break;
+        }
+
+        if (errno!=EEXIST) {
+            cerr<<"failed to create the shared memory "<<name<<": "<<strerror(errno)<<endl;
+            ret=-1;
+            break;
+        }
+
+        fd=shm_open(name.c_str(),O_RDWR,0);
+        if (fd<0) {
+            // removed in between, try to create it again.
+            continue;
+        }
+        ret=attach_shm(fd,name);
+        close(fd);
+        if (ret!=0) {
+            break;
+        }
+    }
+
+    if (ret==0 && shm_control==nullptr) {
+        cerr<<"failed to open the shared memory "<<name<<endl;
+        ret=-1;
+    }
+    if (ret==-1) {
+        shm_slots[slot].used.store(false);
+        return -1;
+    }
+    shm_slot=slot;
+    shm_slots[slot].control.store(shm_control);
+    return ret;
+}
+
+// return 0 if the segment is stale and we should retry.
+int HeuristicTable::attach_shm(int fd, const string & name) {
+    DEV_DEBUG("[start] attach shared heuristics {}.", name);
+    ONLYDEV(g_timer.record_p("heu/attach_shm_start");)
+
+    auto expected=make_file_header();
+
+    // the creator resizes the segment and writes its pid right after creating the name.
+    // if we still don't know it after the timeout, it died in between and nobody else would remove the name.
+    auto deadline=std::chrono::steady_clock::now()+std::chrono::milliseconds(HEURISTIC_SHM_INIT_TIMEOUT_MS);
+
+    // wait for the creator to resize the segment.
+    struct stat st;
+    while (true) {
+        if (fstat(fd,&st)!=0) {
+            return -1;
+        }
+        if ((uint64_t)st.st_size>=expected.file_size) {
+            break;
+        }
+        if (st.st_size!=0) {
+            cerr<<"the shared memory "<<name<<" has a wrong size"<<endl;
+            return -1;
+        }
+        if (std::chrono::steady_clock::now()>deadline) {
+            cerr<<"the shared memory "<<name<<" is never resized, remove it"<<endl;
+            shm_unlink(name.c_str());
+            return 0;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    // only the header page with the control block is writable, the tables are read-only.
+    void * addr=mmap(nullptr,expected.file_size,PROT_READ,MAP_SHARED,fd,0);
+    if (addr==MAP_FAILED) {
+        cerr<<"failed to mmap the shared memory "<<name<<endl;
+        return -1;
+    }
+    if (mprotect(addr,HEURISTIC_SHM_CONTROL_OFFSET+sizeof(HeuristicShmControl),PROT_READ|PROT_WRITE)!=0) {
+        cerr<<"failed to make the control block of the shared memory "<<name<<" writable"<<endl;
+        munmap(addr,expected.file_size);
+        return -1;
+    }
+    auto control=(HeuristicShmControl *)((char *)addr+HEURISTIC_SHM_CONTROL_OFFSET);
+
+    // wait for the creator to publish the tables, unless it died before that.
+    while (control->ready.load(std::memory_order_acquire)==0) {
+        int pid=control->creator_pid;
+        if ((pid!=0 && kill(pid,0)!=0 && errno==ESRCH) || (pid==0 && std::chrono::steady_clock::now()>deadline)) {
+            cerr<<"the creator of the shared memory "<<name<<" died, remove it"<<endl;
+            munmap(addr,expected.file_size);
+            shm_unlink(name.c_str());
+            return 0;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    // the last user may be detaching right now, then the name is already unlinked.
+    int32_t refcount=control->refcount.load();
+    do {
+        if (refcount<=0) {
+            munmap(addr,expected.file_size);
+            return 0;
+        }
+    } while (!control->refcount.compare_exchange_weak(refcount,refcount+1));
+
+    auto header=(HeuristicFileHeader *)addr;
+    if (!check_file_header(*header,expected)
+        || memcmp((char *)addr+header->empty_locs_offset,empty_locs,sizeof(int)*loc_size)!=0) {
+        cerr<<"the shared memory "<<name<<" doesn't match the current map and weights"<<endl;
+        if (control->refcount.fetch_sub(1)==1) {
+            shm_unlink(name.c_str());
+        }
+        munmap(addr,expected.file_size);
+        return -1;
+    }
+
+    shm_name=name;
+    shm_addr=addr;
+    shm_size=expected.file_size;
+    shm_control=control;
+    mmap_addr=addr;
+    mmap_size=expected.file_size;
+    if (quantized) {
+        main_scale=header->main_scale;
+        sub_scale=header->sub_scale;
+        main_heuristics_q=(uint16_t *)((char *)addr+header->main_offset);
+        if (consider_rotation)
+            sub_heuristics_q=(uint8_t *)((char *)addr+header->sub_offset);
+    } else {
+        main_heuristics=(float *)((char *)addr+header->main_offset);
+        if (consider_rotation)
+            sub_heuristics=(float *)((char *)addr+header->sub_offset);
+    }
+
+    ONLYDEV(g_timer.record_d("heu/attach_shm_start","heu/attach_shm_end","heu/attach_shm");)
+    DEV_DEBUG("[end] attach shared heuristics {}. (duration: {:.3f})", name, g_timer.get_d("heu/attach_shm"));
+    return 1;
+}
+
+// copy the tables into the segment we created, then switch to it.
+void HeuristicTable::publish_shm() {
+    auto header=make_file_header();
+    char * addr=(char *)shm_addr;
+    size_t main_size=(quantized?sizeof(uint16_t):sizeof(float))*loc_size*loc_size;
+    size_t sub_size=(quantized?sizeof(uint8_t):sizeof(float))*state_size*loc_size;
+
+    memcpy(addr,&header,sizeof(header));
+    memcpy(addr+header.empty_locs_offset,empty_locs,sizeof(int)*loc_size);
+    memcpy(addr+header.main_offset,quantized?(void *)main_heuristics_q:(void *)main_heuristics,main_size);
+    if (consider_rotation)
+        memcpy(addr+header.sub_offset,quantized?(void *)sub_heuristics_q:(void *)sub_heuristics,sub_size);
+
+    if (mmap_addr!=nullptr) {
+        munmap(mmap_addr,mmap_size);
+    } else {
+        delete [] main_heuristics;
+        delete [] sub_heuristics;
+        delete [] main_heuristics_q;
+        delete [] sub_heuristics_q;
+    }
+
+    mmap_addr=shm_addr;
+    mmap_size=shm_size;
+    if (quantized) {
+        main_heuristics_q=(uint16_t *)(addr+header.main_offset);
+        sub_heuristics_q=consider_rotation?(uint8_t *)(addr+header.sub_offset):nullptr;
+    } else {
+        main_heuristics=(float *)(addr+header.main_offset);
+        sub_heuristics=consider_rotation?(float *)(addr+header.sub_offset):nullptr;
+    }
+
+    // nobody writes the tables any more, neither do we.
+    mprotect(addr+header.empty_locs_offset,shm_size-header.empty_locs_offset,PROT_READ);
+
+    shm_control->ready.store(1,std::memory_order_release);
+    close(shm_fd);
+    shm_fd=-1;
+    DEV_DEBUG("published shared heuristics {}", shm_name);
+}
+
+// the last process using a shared table removes its name, the pages go away with the last mapping.
+void HeuristicTable::release_shm() {
+    if (shm_slot==-1)
+        return;
+    if (release_shm_slot(shm_slot)) {
+        DEV_DEBUG("removed shared heuristics {}", shm_name);
+    }
+    shm_slots[shm_slot].used.store(false);
+    shm_slot=-1;
+    shm_control=nullptr;
+}
+
+void HeuristicTable::release_all_shm() {
+    for (int slot=0;slot<MAX_SHM_TABLES;++slot) {
+        release_shm_slot(slot);
+    }
+}
@@ -0,0 +1,55 @@
+#include "util/StateGraph.h"
+#include <iostream>
+
+StateGraph::StateGraph(const SharedEnvironment & env, const std::vector<float> & map_weights):
+    rows(env.rows), cols(env.cols) {
+    // east, south, west, north
+    const int dx[4]={1,0,-1,0};
+    const int dy[4]={0,1,0,-1};
+
+    size_t n_states=(size_t)rows*cols*n_orients;
+    // the offsets are 32-bit to keep the index compact
+    if (n_states*max_degree>UINT32_MAX) {
+        std::cerr<<"the map is too large for the state graph: "<<rows<<"x"<<cols<<std::endl;
+        exit(-1);
+    }
+    offsets.resize(n_states+1);
+    edges.reserve(n_states*max_degree);
+
+    for (int pos=0;pos<rows*cols;++pos) {
+        int x=pos%cols;
+        int y=pos/cols;
+        for (int orient=0;orient<n_orients;++orient) {
+            offsets[pos*n_orients+orient]=(uint32_t)edges.size();
+            if (env.map[pos]) {
+                continue;
+            }
+
+            // FW
+            int nx=x+dx[orient];
+            int ny=y+dy[orient];
+            if (nx>=0 && nx<cols && ny>=0 && ny<rows && !env.map[ny*cols+nx]) {
+                edges.push_back({ny*cols+nx,(uint8_t)orient,(uint8_t)FW,map_weights[pos*n_dirs+orient]});
+            }
+
+            // CR, CCR, W
+            float rotate_weight=map_weights[pos*n_dirs+4];
+            edges.push_back({pos,(uint8_t)((orient+1)%n_orients),(uint8_t)CR,rotate_weight});
+            edges.push_back({pos,(uint8_t)((orient+n_orients-1)%n_orients),(uint8_t)CCR,rotate_weight});
+            edges.push_back({pos,(uint8_t)orient,(uint8_t)W,rotate_weight});
+        }
+    }
+    offsets[n_states]=(uint32_t)edges.size();
+    edges.shrink_to_fit();
+}
+
+void StateGraph::update_weights(const std::vector<float> & map_weights) {
+    for (int pos=0;pos<rows*cols;++pos) {
+        for (int orient=0;orient<n_orients;++orient) {
+            int state=pos*n_orients+orient;
+            for (uint32_t k=offsets[state];k<offsets[state+1];++k) {
+                edges[k].weight=edges[k].action==FW?map_weights[pos*n_dirs+orient]:map_weights[pos*n_dirs+4];
+            }
+        }
+    }
+}
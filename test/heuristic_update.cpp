@@ -0,0 +1,108 @@
+#include "util/HeuristicTable.h"
+#include <vector>
+#include <random>
+#include <cmath>
+
+// update_weights repairs the tables in place, so after every round of random weight changes
+// they have to be the same as the tables recomputed from scratch with the new weights.
+
+static bool same(float a, float b) {
+    if (a>=MAX_HEURISTIC || b>=MAX_HEURISTIC)
+        return a>=MAX_HEURISTIC && b>=MAX_HEURISTIC;
+    return std::fabs(a-b)<=1e-4f*std::max(1.0f,std::fabs(a));
+}
+
+static int compare_tables(SharedEnvironment & env, HeuristicTable & updated, const std::vector<float> & weights, bool consider_rotation) {
+    auto fresh_weights=std::make_shared<std::vector<float> >(weights);
+    HeuristicTable fresh(&env,fresh_weights,consider_rotation);
+    fresh.select_open_list();
+    fresh.alloc_tables();
+    fresh.compute_weighted_heuristics();
+
+    int n_errors=0;
+    for (int loc1=0;loc1<env.map.size();++loc1) {
+        for (int loc2=0;loc2<env.map.size();++loc2) {
+            if (!same(updated.get(loc1,loc2),fresh.get(loc1,loc2))) {
+                if (n_errors<10)
+                    printf("main %d->%d: updated %f, recomputed %f\n",loc1,loc2,updated.get(loc1,loc2),fresh.get(loc1,loc2));
+                ++n_errors;
+            }
+            if (!consider_rotation)
+                continue;
+            for (int orient=0;orient<4;++orient) {
+                if (!same(updated.get(loc1,orient,loc2),fresh.get(loc1,orient,loc2))) {
+                    if (n_errors<10)
+                        printf("sub %d,%d->%d: updated %f, recomputed %f\n",loc1,orient,loc2,updated.get(loc1,orient,loc2),fresh.get(loc1,orient,loc2));
+                    ++n_errors;
+                }
+            }
+        }
+    }
+    return n_errors;
+}
+
+static int run(bool consider_rotation, int seed) {
+    std::mt19937 rng(seed);
+
+    SharedEnvironment env;
+    env.rows=9;
+    env.cols=11;
+    env.map.resize(env.rows*env.cols,0);
+    std::uniform_int_distribution<int> cell(0,env.rows*env.cols-1);
+    for (int i=0;i<15;++i) {
+        env.map[cell(rng)]=1;
+    }
+
+    std::uniform_int_distribution<int> weight(1,6);
+    auto weights=std::make_shared<std::vector<float> >(env.map.size()*5);
+    for (auto & w: *weights) {
+        w=(float)weight(rng);
+    }
+
+    HeuristicTable updated(&env,weights,consider_rotation);
+    updated.select_open_list();
+    updated.alloc_tables();
+    updated.compute_weighted_heuristics();
+
+    int n_errors=0;
+    std::uniform_int_distribution<int> entry(0,(int)weights->size()-1);
+    for (int round=0;round<20;++round) {
+        std::vector<float> new_weights(*weights);
+        // a few changes take the repair, many of them the fallback of recomputing whole rows.
+        int n_changes=round%4==3?60:1+round%4*3;
+        for (int i=0;i<n_changes;++i) {
+            int idx=entry(rng);
+            // increases only, decreases only, then mixed
+            float w=(float)weight(rng);
+            if (round%3==0)
+                w=std::max(w,new_weights[idx]);
+            else if (round%3==1)
+                w=std::min(w,new_weights[idx]);
+            new_weights[idx]=w;
+        }
+
+        updated.update_weights(new_weights);
+        int n=compare_tables(env,updated,new_weights,consider_rotation);
+        if (n>0)
+            printf("rotation %d, seed %d, round %d: %d mismatches\n",consider_rotation,seed,round,n);
+        n_errors+=n;
+    }
+    return n_errors;
+}
+
+int main() {
+    g_logger.init("logs/test_heuristic_update","g",spdlog::level::warn);
+
+    int n_errors=0;
+    for (int seed=0;seed<5;++seed) {
+        n_errors+=run(false,seed);
+        n_errors+=run(true,seed);
+    }
+
+    if (n_errors>0) {
+        printf("failed: %d mismatches\n",n_errors);
+        return 1;
+    }
+    printf("passed\n");
+    return 0;
+}
@@ -0,0 +1,168 @@
+#include "LaCAM2/planner.hpp"
+#include "Grid.h"
+#include <vector>
+#include <chrono>
+#include <fstream>
+#include <cstdio>
+
+// times get_new_config on one high-level node of a shipped example problem, as it is called while the low-level
+// tree of the node is expanded. it compares the journaled reset of the occupancy tables with the full reset
+// of all the agents that was done on every call before. the configurations found with both have to be the same.
+// it also times the banded PIBT (pibt_tiles), whose configuration has to be free of vertex and swap conflicts.
+
+using namespace LaCAM2;
+
+static std::vector<int> read_locations(const std::string & fname, int n) {
+    std::ifstream file(fname);
+    if (!file.is_open()) {
+        printf("%s does not exist\n",fname.c_str());
+        exit(-1);
+    }
+    int size;
+    file>>size;
+    std::vector<int> locs;
+    for (int i=0;i<size && (int)locs.size()<n;++i) {
+        int loc;
+        file>>loc;
+        locs.push_back(loc);
+    }
+    return locs;
+}
+
+// the full reset, as get_new_config did before the journal
+static void full_reset(Planner & planner) {
+    planner.H_occupied=nullptr;
+    for (auto a: planner.A) a->v_next=nullptr;
+    planner.moved.clear();
+}
+
+static int count_conflicts(Planner & planner) {
+    int n_conflicts=0;
+    std::vector<int> agent_at(planner.V_size,-1);
+    for (auto a: planner.A) {
+        if (a->v_next==nullptr) {
+            ++n_conflicts;
+            continue;
+        }
+        if (agent_at[a->v_next->id]>=0)
+            ++n_conflicts;
+        agent_at[a->v_next->id]=(int)a->id;
+    }
+    for (auto a: planner.A) {
+        if (a->v_next==nullptr)
+            continue;
+        int other=agent_at[a->v_now->id];
+        if (other>=0 && other!=(int)a->id && planner.A[other]->v_now==a->v_next)
+            ++n_conflicts;
+    }
+    return n_conflicts;
+}
+
+static std::vector<int> next_locations(Planner & planner) {
+    std::vector<int> locs;
+    for (auto a: planner.A) locs.push_back(a->v_next!=nullptr?(int)a->v_next->index:-1);
+    return locs;
+}
+
+// average time of one call in us
+static double time_calls(Planner & planner, HNode * H, LNode * L, int n_calls, bool reset, bool expected) {
+    auto start=std::chrono::steady_clock::now();
+    for (int i=0;i<n_calls;++i) {
+        if (reset)
+            full_reset(planner);
+        if (planner.get_new_config(H,L)!=expected) {
+            printf("get_new_config returned %d\n",!expected);
+            exit(-1);
+        }
+    }
+    auto end=std::chrono::steady_clock::now();
+    return std::chrono::duration<double,std::micro>(end-start).count()/n_calls;
+}
+
+int main(int argc, char ** argv) {
+    std::string domain=argc>1?argv[1]:"example_problems/warehouse.domain";
+    int N=argc>2?atoi(argv[2]):1000;
+    int n_calls=argc>3?atoi(argv[3]):20000;
+
+    g_logger.init("logs/test_lacam2_get_new_config","g",spdlog::level::warn);
+
+    Grid grid(domain+"/maps/warehouse_small.map");
+    SharedEnvironment env;
+    env.rows=grid.rows;
+    env.cols=grid.cols;
+    env.map=grid.map;
+    env.num_of_agents=N;
+
+    auto map_weights=std::make_shared<std::vector<float> >(env.map.size()*5,1.0f);
+    auto HT=std::make_shared<HeuristicTable>(&env,map_weights,true);
+    HT->select_open_list();
+    HT->alloc_tables();
+    HT->compute_weighted_heuristics();
+
+    auto starts=read_locations(domain+"/agents/warehouse_small_"+std::to_string(N)+".agents",N);
+    auto goals=read_locations(domain+"/tasks/warehouse_small.tasks",N);
+    if ((int)starts.size()<N) {
+        printf("only %d agents\n",(int)starts.size());
+        return 1;
+    }
+    std::vector<std::pair<uint,int> > start_indexes, goal_indexes;
+    std::vector<AgentInfo> agent_infos(N);
+    for (int i=0;i<N;++i) {
+        start_indexes.emplace_back(starts[i],0);
+        goal_indexes.emplace_back(goals[i],0);
+        agent_infos[i].id=i;
+        agent_infos[i].goal_location=goals[i];
+    }
+
+    Graph G(env);
+    Instance ins(G,start_indexes,goal_indexes,agent_infos);
+    Deadline deadline(1e9);
+    std::mt19937 MT(0);
+    Planner planner(&ins,HT,map_weights,&deadline,&MT,0,OBJ_SUM_OF_LOSS,0.0f,false,false,false,false);
+    for (int i=0;i<N;++i) planner.A[i]=planner.arena->create<Agent>(i);
+
+    auto H=planner.arena->create<HNode>(ins.starts,HT,&ins,nullptr,0.0f,planner.get_h_value(ins.starts),0,0,false,planner.arena);
+    auto L_root=planner.arena->create<LNode>();
+
+    // a failed expansion: the last two constraints of the low-level node put two agents on the same vertex,
+    // as happens when the low-level tree of a node is expanded further.
+    auto v=G.U[starts[0]]->neighbor[0];
+    auto L1=planner.arena->create<LNode>(L_root,0,std::make_tuple(v,0));
+    auto L_fail=planner.arena->create<LNode>(L1,1,std::make_tuple(v,0));
+
+    int n_errors=0;
+
+    // both resets find the same configuration, also after a failed call
+    full_reset(planner);
+    planner.get_new_config(H,L_root);
+    auto expected=next_locations(planner);
+    planner.get_new_config(H,L_fail);
+    planner.get_new_config(H,L_root);
+    if (next_locations(planner)!=expected) {
+        printf("the configuration after the journaled reset is different\n");
+        ++n_errors;
+    }
+
+    double fail_full=time_calls(planner,H,L_fail,n_calls,true,false);
+    double fail_journal=time_calls(planner,H,L_fail,n_calls,false,false);
+    double success_full=time_calls(planner,H,L_root,n_calls/10,true,true);
+    double success_journal=time_calls(planner,H,L_root,n_calls/10,false,true);
+
+    planner.pibt_tiles=4;
+    double success_tiles=time_calls(planner,H,L_root,n_calls/10,false,true);
+    int n_conflicts=count_conflicts(planner);
+    if (n_conflicts>0) {
+        printf("%d conflicts in the configuration of the banded PIBT\n",n_conflicts);
+        n_errors+=n_conflicts;
+    }
+
+    printf("%d agents, failed expansion: full reset %.3f us, journal %.3f us\n",N,fail_full,fail_journal);
+    printf("%d agents, successful expansion: full reset %.3f us, journal %.3f us, 4 bands %.3f us\n",N,success_full,success_journal,success_tiles);
+
+    if (n_errors>0) {
+        printf("failed: %d mismatches\n",n_errors);
+        return 1;
+    }
+    printf("passed\n");
+    return 0;
+}
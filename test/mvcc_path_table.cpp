@@ -0,0 +1,238 @@
+#include "LNS/Parallel/MVCCPathTable.h"
+#include "LNS/PathTable.h"
+#include <vector>
+#include <random>
+#include <thread>
+#include <atomic>
+#include <cstdio>
+
+// one writer commits random neighbors while the readers check their snapshots against the state recorded at that epoch.
+// a version reused while a snapshot can still see it shows up as a mismatch. the writer also replays every commit
+// on a plain PathTable and checks that the newest versions are the same.
+
+namespace LNS {
+
+namespace Parallel {
+
+static const int map_size=96;
+static const int window_size=5;
+static const int num_of_agents=12;
+static const int num_of_readers=4;
+static const int num_of_commits=3000;
+
+// the state after a commit
+struct Expected {
+    std::vector<int> agents; // indexed by t*map_size+loc
+    std::vector<int> prevs;
+    std::vector<Path> paths;
+};
+
+static bool same_path(const Path & a, const Path & b) {
+    if (a.nodes.size()!=b.nodes.size())
+        return false;
+    for (size_t i=0;i<a.nodes.size();++i) {
+        if (a.nodes[i].location!=b.nodes[i].location || a.nodes[i].orientation!=b.nodes[i].orientation)
+            return false;
+    }
+    return true;
+}
+
+static int check_snapshot(const MVCCPathTable & table, uint64_t snapshot, const Expected & expected) {
+    int n_errors=0;
+    for (int t=0;t<table.horizon();++t) {
+        for (int loc=0;loc<map_size;++loc) {
+            int idx=t*map_size+loc;
+            auto v=table.getCell(loc,t,snapshot);
+            int agent=v!=nullptr?v->agent:NO_AGENT;
+            if (v!=nullptr && v->epoch>snapshot)
+                ++n_errors;
+            if (agent!=expected.agents[idx] || (agent!=NO_AGENT && v->prev!=expected.prevs[idx]))
+                ++n_errors;
+        }
+        // let the writer commit and collect in the middle of the check
+        std::this_thread::yield();
+    }
+    for (int aid=0;aid<num_of_agents;++aid) {
+        if (!same_path(table.getPath(aid,snapshot),expected.paths[aid]))
+            ++n_errors;
+    }
+    return n_errors;
+}
+
+static int check_latest(const MVCCPathTable & table, const PathTable & replayed) {
+    int n_errors=0;
+    for (int t=0;t<table.horizon();++t) {
+        for (int loc=0;loc<map_size;++loc) {
+            auto v=table.getCell(loc,t,MVCCPathTable::LATEST);
+            int agent=v!=nullptr?v->agent:NO_AGENT;
+            auto & cell=replayed.table[t*map_size+loc];
+            if (agent!=cell.agent || (agent!=NO_AGENT && v->prev!=cell.prev)) {
+                if (n_errors<10)
+                    printf("latest %d@%d: agent %d prev %d, replayed agent %d prev %d\n",loc,t,agent,agent!=NO_AGENT?v->prev:-1,cell.agent,cell.prev);
+                ++n_errors;
+            }
+        }
+    }
+    return n_errors;
+}
+
+// the agents use disjoint cells, so their paths never collide
+static Path random_path(int aid, std::mt19937 & rng) {
+    std::uniform_int_distribution<int> length(1,window_size+3);
+    std::uniform_int_distribution<int> cell(0,map_size/num_of_agents-1);
+    std::uniform_int_distribution<int> orient(0,3);
+    Path path;
+    path.clear();
+    int n=length(rng);
+    for (int i=0;i<n;++i) {
+        path.nodes.emplace_back(cell(rng)*num_of_agents+aid,orient(rng));
+    }
+    path.path_cost=(float)n;
+    return path;
+}
+
+static Expected record(const std::vector<Path> & paths, int horizon) {
+    Expected expected;
+    expected.agents.assign((size_t)horizon*map_size,NO_AGENT);
+    expected.prevs.assign((size_t)horizon*map_size,-1);
+    expected.paths=paths;
+    for (int aid=0;aid<num_of_agents;++aid) {
+        auto & nodes=paths[aid].nodes;
+        for (int t=0;t<(int)nodes.size() && t<horizon;++t) {
+            expected.agents[t*map_size+nodes[t].location]=aid;
+            expected.prevs[t*map_size+nodes[t].location]=t>0?nodes[t-1].location:-1;
+        }
+    }
+    return expected;
+}
+
+static int run(MVCCPathTable & table, int seed) {
+    std::mt19937 rng(seed);
+    int n_errors=0;
+
+    // written before the epoch is published, so a reader only reads the entries of published epochs.
+    // the epochs go on after a reset, so the entries are counted from the current one.
+    const uint64_t first_epoch=table.acquire(0);
+    table.release(0);
+    std::vector<Expected> history(num_of_commits+1);
+    std::vector<Path> paths(num_of_agents);
+    for (auto & path: paths) {
+        path.clear();
+    }
+    history[0]=record(paths,table.horizon());
+
+    std::atomic<bool> done{false};
+    std::atomic<int> reader_errors{0};
+    std::atomic<int> n_checks{0};
+    std::vector<std::thread> readers;
+    for (int r=0;r<num_of_readers;++r) {
+        readers.emplace_back([&,r]() {
+            std::mt19937 reader_rng(seed*num_of_readers+r+1);
+            while (!done.load()) {
+                auto snapshot=table.acquire(r);
+                // check the same snapshot a few times, the writer keeps committing meanwhile
+                int n=1+reader_rng()%3;
+                for (int i=0;i<n;++i) {
+                    int e=check_snapshot(table,snapshot,history[snapshot-first_epoch]);
+                    if (e>0)
+                        printf("reader %d, snapshot %llu: %d mismatches\n",r,(unsigned long long)snapshot,e);
+                    reader_errors+=e;
+                    ++n_checks;
+                }
+                // a local optimizer may acquire again without releasing
+                if (reader_rng()%2==0)
+                    table.release(r);
+                std::this_thread::yield();
+            }
+            table.release(r);
+        });
+    }
+
+    PathTable replayed(map_size,window_size);
+    std::uniform_int_distribution<int> neighbor_size(1,4);
+    std::uniform_int_distribution<int> agent(0,num_of_agents-1);
+    for (int e=1;e<=num_of_commits;++e) {
+        Neighbor neighbor;
+        // the first commit sets the paths of all the agents
+        int n=e==1?num_of_agents:neighbor_size(rng);
+        while ((int)neighbor.agents.size()<n) {
+            int aid=e==1?(int)neighbor.agents.size():agent(rng);
+            if (std::find(neighbor.agents.begin(),neighbor.agents.end(),aid)!=neighbor.agents.end())
+                continue;
+            neighbor.agents.push_back(aid);
+            neighbor.m_old_paths[aid]=paths[aid];
+            neighbor.m_paths[aid]=random_path(aid,rng);
+        }
+
+        for (auto aid: neighbor.agents) {
+            replayed.deletePath(aid,paths[aid]);
+            paths[aid]=neighbor.m_paths[aid];
+        }
+        for (auto aid: neighbor.agents) {
+            replayed.insertPath(aid,paths[aid]);
+        }
+        history[e]=record(paths,table.horizon());
+
+        table.commit(neighbor);
+        n_errors+=check_latest(table,replayed);
+        std::this_thread::yield();
+    }
+
+    done=true;
+    for (auto & reader: readers) {
+        reader.join();
+    }
+    n_errors+=reader_errors.load();
+
+    // the commit records list the agents of every commit in order
+    uint64_t epoch=first_epoch;
+    for (auto c=table.firstCommit()->next.load();c!=nullptr;c=c->next.load()) {
+        if (c->epoch!=++epoch)
+            ++n_errors;
+    }
+    if (epoch-first_epoch!=(uint64_t)num_of_commits) {
+        printf("%llu commit records for %d commits\n",(unsigned long long)(epoch-first_epoch),num_of_commits);
+        ++n_errors;
+    }
+
+    // a view with a shorter window, as the ones of the local optimizers, sees the first steps of the base
+    // apart from the hidden agents
+    PathTable view(map_size,window_size-3);
+    view.setBase(&table,num_of_agents);
+    view.hide(0);
+    for (int t=0;t<table.horizon()+1;++t) {
+        for (int loc=0;loc<map_size;++loc) {
+            int agent=t<view.horizon()?table.getAgent(loc,t,MVCCPathTable::LATEST):NO_AGENT;
+            if (agent==0)
+                agent=NO_AGENT;
+            if (view.getAgent(loc,t)!=agent)
+                ++n_errors;
+        }
+    }
+
+    printf("seed %d: %d reader checks\n",seed,n_checks.load());
+    return n_errors;
+}
+
+}
+
+}
+
+int main() {
+    using namespace LNS::Parallel;
+    MVCCPathTable table(map_size,window_size,num_of_agents,num_of_readers);
+
+    int n_errors=0;
+    for (int seed=0;seed<3;++seed) {
+        // the versions freed by the reset are reused by the next run
+        table.reset();
+        n_errors+=run(table,seed);
+    }
+
+    if (n_errors>0) {
+        printf("failed: %d mismatches\n",n_errors);
+        return 1;
+    }
+    printf("passed\n");
+    return 0;
+}